@@ -0,0 +1,152 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+#include "accum_file.h"
+
+namespace visionaray
+{
+
+static constexpr uint32_t accum_version = 1;
+static char const accum_magic[8] = { 'V', 'S', 'N', 'R', 'A', 'C', 'C', '\0' };
+
+struct accum_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved0;
+    uint64_t sample_first;
+    uint64_t sample_count;
+    uint64_t reserved1[3];
+};
+
+static_assert(sizeof(accum_header) == 64, "accum_header must be 64 bytes");
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+bool write_accum_file(std::string const& filename, accum_info const& info, vec4 const* accum)
+{
+    std::ofstream out(filename, std::ios::binary);
+
+    if (!out.good())
+    {
+        return false;
+    }
+
+    accum_header header = {};
+    std::memcpy(header.magic, accum_magic, sizeof(accum_magic));
+    header.version      = accum_version;
+    header.width        = info.width;
+    header.height       = info.height;
+    header.sample_first = info.sample_first;
+    header.sample_count = info.sample_count;
+
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.write(reinterpret_cast<char const*>(accum), size_t(info.width) * info.height * sizeof(vec4));
+
+    return out.good();
+}
+
+bool read_accum_file(std::string const& filename, accum_info& info, std::vector<vec4>& accum)
+{
+    std::ifstream in(filename, std::ios::binary);
+
+    accum_header header;
+
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || std::memcmp(header.magic, accum_magic, sizeof(accum_magic)) != 0
+     || header.version != accum_version)
+    {
+        return false;
+    }
+
+    info.width        = header.width;
+    info.height       = header.height;
+    info.sample_first = header.sample_first;
+    info.sample_count = header.sample_count;
+
+    accum.resize(size_t(info.width) * info.height);
+
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(accum.data()), accum.size() * sizeof(vec4)));
+}
+
+bool merge_accum(
+        std::vector<accum_info> const&          infos,
+        std::vector<std::vector<vec4>> const&   parts,
+        accum_info&                             merged_info,
+        std::vector<vec4>&                      merged,
+        std::string&                            error
+        )
+{
+    if (infos.empty())
+    {
+        error = "no input";
+        return false;
+    }
+
+    // Disjoint sample ranges, sorted by first sample
+    std::vector<size_t> order(infos.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return infos[a].sample_first < infos[b].sample_first;
+    });
+
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        auto const& prev = infos[order[i - 1]];
+        auto const& curr = infos[order[i]];
+
+        if (prev.sample_first + prev.sample_count > curr.sample_first)
+        {
+            error = "overlapping sample ranges starting at " + std::to_string(prev.sample_first)
+                  + " and " + std::to_string(curr.sample_first);
+            return false;
+        }
+    }
+
+    merged_info = infos[order[0]];
+    merged_info.sample_count = 0;
+
+    for (auto const& info : infos)
+    {
+        if (info.width != merged_info.width || info.height != merged_info.height)
+        {
+            error = "image sizes differ";
+            return false;
+        }
+
+        merged_info.sample_count += info.sample_count;
+    }
+
+    if (merged_info.sample_count == 0)
+    {
+        error = "no samples";
+        return false;
+    }
+
+    merged.assign(size_t(merged_info.width) * merged_info.height, vec4(0.0f));
+
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        float weight = static_cast<float>(double(infos[i].sample_count) / merged_info.sample_count);
+
+        for (size_t p = 0; p < merged.size(); ++p)
+        {
+            merged[p] += parts[i][p] * weight;
+        }
+    }
+
+    return true;
+}
+
+} // namespace visionaray
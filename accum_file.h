@@ -0,0 +1,45 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <visionaray/math/math.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Partial accumulation buffers
+//
+// A 64 byte header (magic "VSNRACC", version, width, height, first sample
+// index, sample count) followed by width * height RGBA32F pixels: the mean
+// over the sample range, in the layout of the accumulation buffer. Native
+// byte order
+//
+
+struct accum_info
+{
+    uint32_t width          = 0;
+    uint32_t height         = 0;
+    uint64_t sample_first   = 0;
+    uint64_t sample_count   = 0;
+};
+
+bool write_accum_file(std::string const& filename, accum_info const& info, vec4 const* accum);
+
+bool read_accum_file(std::string const& filename, accum_info& info, std::vector<vec4>& accum);
+
+// Sample-count weighted mean of partial buffers of the same size. Fails if
+// sizes differ or sample ranges overlap
+bool merge_accum(
+        std::vector<accum_info> const&          infos,
+        std::vector<std::vector<vec4>> const&   parts,
+        accum_info&                             merged_info,
+        std::vector<vec4>&                      merged,
+        std::string&                            error
+        );
+
+} // namespace visionaray
@@ -0,0 +1,198 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include <visionaray/math/math.h>
+
+#include "build_strategy.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Cost model constants. These are rough per-item timings (seconds) measured
+// on a single core with the builders and the float8 kernel; only their ratios
+// matter for the decision
+//
+
+static constexpr float binned_build_cost    = 50.0e-9f;  // per N log N, binned SAH
+static constexpr float lbvh_build_cost      = 10.0e-9f;  // per N log N, morton sort dominated
+static constexpr float split_build_factor   = 3.0f;      // spatial split search vs. binned
+static constexpr float trace_cost           = 8.0e-9f;   // per ray and tree level
+static constexpr float lbvh_trace_factor    = 1.35f;     // LBVH tree quality vs. binned SAH
+static constexpr float min_split_gain       = 0.02f;     // below that the estimate is noise
+static constexpr float max_split_gain       = 0.4f;      // best case trace speedup of split BVHs
+static constexpr float typical_occupancy    = 4.0f;      // bbox occupancy of a surface that fills the scene box
+
+static char const* strategy_names[] = { "default", "split", "lbvh" };
+
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static float surface_area(aabb const& box)
+{
+    vec3 s = max(box.max - box.min, vec3(0.0f));
+    return 2.0f * (s.x * s.y + s.y * s.z + s.z * s.x);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Quick pre-pass over (a subset of) the triangles
+//
+
+scene_statistics gather_scene_statistics(
+        model::triangle_list const& triangles,
+        aabb const&                 bbox,
+        size_t                      max_samples
+        )
+{
+    scene_statistics result;
+    result.num_triangles = triangles.size();
+
+    if (triangles.empty())
+    {
+        return result;
+    }
+
+    size_t stride = std::max(size_t(1), triangles.size() / std::max(size_t(1), max_samples));
+
+    double area_sum = 0.0;
+    double area_sq_sum = 0.0;
+    double bbox_area_sum = 0.0;
+    double ratio_sum = 0.0;
+
+    for (size_t i = 0; i < triangles.size(); i += stride)
+    {
+        auto const& tri = triangles[i];
+
+        float area = 0.5f * length(cross(tri.e1, tri.e2));
+
+        aabb box;
+        box.invalidate();
+        box.insert(tri.v1);
+        box.insert(tri.v1 + tri.e1);
+        box.insert(tri.v1 + tri.e2);
+        float bbox_area = surface_area(box);
+
+        area_sum += area;
+        area_sq_sum += double(area) * area;
+        bbox_area_sum += bbox_area;
+
+        // An axis-aligned right triangle has bbox_area == 4 * area
+        if (area > 0.0f)
+        {
+            ratio_sum += bbox_area / (4.0f * area);
+        }
+
+        ++result.num_samples;
+    }
+
+    double n = static_cast<double>(result.num_samples);
+    double mean = area_sum / n;
+    double variance = std::max(0.0, area_sq_sum / n - mean * mean);
+
+    result.mean_area = static_cast<float>(mean);
+    result.area_cv = mean > 0.0 ? static_cast<float>(std::sqrt(variance) / mean) : 0.0f;
+    result.mean_bbox_area_ratio = static_cast<float>(ratio_sum / n);
+
+    float scene_area = surface_area(bbox);
+    if (scene_area > 0.0f)
+    {
+        // Extrapolate from the samples to all triangles
+        double scale = result.num_triangles / n;
+        result.bbox_occupancy = static_cast<float>(bbox_area_sum * scale / scene_area);
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Pick the strategy with the lowest estimated build + trace time
+//
+
+build_strategy_choice choose_build_strategy(
+        scene_statistics const& stats,
+        size_t                  width,
+        size_t                  height,
+        size_t                  spp,
+        size_t                  rays_per_sample,
+        size_t                  num_threads
+        )
+{
+    build_strategy_choice result;
+
+    float n = static_cast<float>(std::max(stats.num_triangles, size_t(2)));
+    float log_n = std::log2(n);
+    float rays = static_cast<float>(width * height) * spp * rays_per_sample;
+    float threads = static_cast<float>(std::max(num_threads, size_t(1)));
+
+    // Spatial splits pay off for slivers (large bbox-to-area ratio),
+    // strongly varying triangle sizes and triangle boxes that overlap a lot
+    // (bbox occupancy above that of a plain surface)
+    float split_gain = 0.04f * std::log2(std::max(stats.mean_bbox_area_ratio, 1.0f))
+                     + 0.02f * std::log2(1.0f + stats.area_cv)
+                     + 0.03f * std::log2(std::max(stats.bbox_occupancy / typical_occupancy, 1.0f));
+    split_gain = std::min(std::max(split_gain, 0.0f), max_split_gain);
+
+    // Allow more duplication where splits are expected to help more
+    result.max_duplication = 1.0f + std::min(1.0f, 2.5f * split_gain);
+
+    result.build_time[Binned] = binned_build_cost * n * log_n;
+    result.build_time[LBVH]   = lbvh_build_cost * n * log_n;
+    result.build_time[Split]  = result.build_time[Binned] * split_build_factor * result.max_duplication;
+
+    result.trace_time[Binned] = rays * trace_cost * log_n / threads;
+    result.trace_time[LBVH]   = result.trace_time[Binned] * lbvh_trace_factor;
+    result.trace_time[Split]  = result.trace_time[Binned] * (1.0f - split_gain);
+
+    float best = result.build_time[Binned] + result.trace_time[Binned];
+    result.strategy = Binned;
+
+    for (auto s : { Split, LBVH })
+    {
+        if (s == Split && split_gain < min_split_gain)
+        {
+            continue;
+        }
+
+        float total = result.build_time[s] + result.trace_time[s];
+        if (total < best)
+        {
+            best = total;
+            result.strategy = s;
+        }
+    }
+
+    std::ostringstream reason;
+    reason << std::setprecision(3);
+    reason << stats.num_triangles << " triangles (area cv " << stats.area_cv
+           << ", bbox/area ratio " << stats.mean_bbox_area_ratio
+           << ", bbox occupancy " << stats.bbox_occupancy << "), "
+           << rays << " rays (" << width << 'x' << height << ", " << spp << " spp); "
+           << "estimated build + trace [s]:";
+
+    for (auto s : { Binned, Split, LBVH })
+    {
+        reason << ' ' << strategy_names[s] << ' ' << result.build_time[s] << " + " << result.trace_time[s];
+    }
+
+    reason << " => " << strategy_names[result.strategy];
+
+    if (result.strategy == Split)
+    {
+        reason << " (max duplication " << result.max_duplication << ')';
+    }
+
+    result.reason = reason.str();
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,85 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <common/model.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// BVH build strategies
+//
+
+enum bvh_build_strategy
+{
+    Binned = 0, // Binned SAH builder, no spatial splits
+    Split,      // Split BVH, also binned and with SAH
+    LBVH,       // LBVH builder on the CPU
+    Auto,       // Choose from scene statistics and expected number of rays
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Statistics from a quick pre-pass over the triangles
+//
+
+struct scene_statistics
+{
+    size_t num_triangles        = 0;
+
+    // Number of triangles the statistics were sampled from
+    size_t num_samples          = 0;
+
+    // Triangle surface area: mean and coefficient of variation
+    float  mean_area            = 0.0f;
+    float  area_cv              = 0.0f;
+
+    // Summed surface area of the triangle bounding boxes, relative to the
+    // surface area of the scene bounding box. Large for long, thin, diagonal
+    // triangles that make object splits overlap
+    float  bbox_occupancy       = 0.0f;
+
+    // Mean ratio of triangle bounding box surface area to triangle area
+    float  mean_bbox_area_ratio = 0.0f;
+};
+
+scene_statistics gather_scene_statistics(
+        model::triangle_list const& triangles,
+        aabb const&                 bbox,
+        size_t                      max_samples = size_t(1) << 16
+        );
+
+
+//-------------------------------------------------------------------------------------------------
+// Estimate build cost against trace cost and pick a strategy
+//
+
+struct build_strategy_choice
+{
+    bvh_build_strategy strategy = Binned;
+
+    // Spatial-split budget: maximum references / primitives
+    float max_duplication = 1.0f;
+
+    // Estimated build and trace times in seconds, indexed by strategy
+    float build_time[3] = { 0.0f, 0.0f, 0.0f };
+    float trace_time[3] = { 0.0f, 0.0f, 0.0f };
+
+    // Human readable explanation of the decision
+    std::string reason;
+};
+
+build_strategy_choice choose_build_strategy(
+        scene_statistics const& stats,
+        size_t                  width,
+        size_t                  height,
+        size_t                  spp,
+        size_t                  rays_per_sample,
+        size_t                  num_threads
+        );
+
+} // namespace visionaray
@@ -0,0 +1,100 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <iomanip>
+#include <ostream>
+
+#include "bvh_stats.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static void write_json_array(std::ostream& out, std::vector<size_t> const& values)
+{
+    out << '[';
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        out << (i == 0 ? "" : ", ") << values[i];
+    }
+    out << ']';
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Human readable report
+//
+
+void print_bvh_stats(std::ostream& out, bvh_stats const& stats)
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << "BVH statistics:\n";
+    out << "  nodes:             " << stats.num_nodes
+        << " (" << stats.num_inner_nodes << " inner, " << stats.num_leaves << " leaves)\n";
+    out << "  max depth:         " << stats.max_depth << '\n';
+    out << "  primitives:        " << stats.num_primitives << '\n';
+    out << "  references:        " << stats.num_references << '\n';
+    out << "  duplication ratio: " << std::fixed << std::setprecision(3) << stats.duplication_ratio << '\n';
+    out << "  SAH cost:          " << stats.sah_cost << '\n';
+    out << "  sibling overlap:   " << stats.sibling_overlap << '\n';
+    out << "  node bytes:        " << stats.node_bytes << '\n';
+    out << "  index bytes:       " << stats.index_bytes << '\n';
+    out << "  primitive bytes:   " << stats.primitive_bytes << '\n';
+    out.flags(flags);
+    out.precision(precision);
+
+    out << "  leaves per depth:\n";
+    for (size_t i = 0; i < stats.depth_histogram.size(); ++i)
+    {
+        if (stats.depth_histogram[i] > 0)
+        {
+            out << "    " << std::setw(4) << i << ": " << stats.depth_histogram[i] << '\n';
+        }
+    }
+
+    out << "  leaves per size:\n";
+    for (size_t i = 0; i < stats.leaf_size_histogram.size(); ++i)
+    {
+        if (stats.leaf_size_histogram[i] > 0)
+        {
+            out << "    " << std::setw(4) << i << ": " << stats.leaf_size_histogram[i] << '\n';
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// JSON dump
+//
+
+void write_bvh_stats_json(std::ostream& out, bvh_stats const& stats)
+{
+    out << std::setprecision(9);
+    out << "{\n";
+    out << "  \"num_nodes\": " << stats.num_nodes << ",\n";
+    out << "  \"num_inner_nodes\": " << stats.num_inner_nodes << ",\n";
+    out << "  \"num_leaves\": " << stats.num_leaves << ",\n";
+    out << "  \"num_primitives\": " << stats.num_primitives << ",\n";
+    out << "  \"num_references\": " << stats.num_references << ",\n";
+    out << "  \"max_depth\": " << stats.max_depth << ",\n";
+    out << "  \"depth_histogram\": ";
+    write_json_array(out, stats.depth_histogram);
+    out << ",\n";
+    out << "  \"leaf_size_histogram\": ";
+    write_json_array(out, stats.leaf_size_histogram);
+    out << ",\n";
+    out << "  \"sah_cost\": " << stats.sah_cost << ",\n";
+    out << "  \"sibling_overlap\": " << stats.sibling_overlap << ",\n";
+    out << "  \"duplication_ratio\": " << stats.duplication_ratio << ",\n";
+    out << "  \"node_bytes\": " << stats.node_bytes << ",\n";
+    out << "  \"index_bytes\": " << stats.index_bytes << ",\n";
+    out << "  \"primitive_bytes\": " << stats.primitive_bytes << '\n';
+    out << "}\n";
+}
+
+} // namespace visionaray
@@ -0,0 +1,161 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/bvh.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// BVH quality and memory statistics
+//
+
+struct bvh_stats
+{
+    size_t              num_nodes           = 0;
+    size_t              num_inner_nodes     = 0;
+    size_t              num_leaves          = 0;
+    size_t              num_primitives      = 0;    // input primitives (before the build)
+    size_t              num_references      = 0;    // primitive indices referenced by leaves
+    size_t              max_depth           = 0;
+
+    // Leaves per depth, index is the depth (root = 0)
+    std::vector<size_t> depth_histogram;
+
+    // Leaves per primitive count, index is the number of primitives
+    std::vector<size_t> leaf_size_histogram;
+
+    // SAH cost, normalized by the surface area of the root node
+    float               sah_cost            = 0.0f;
+
+    // Summed surface area of the overlap of sibling nodes, normalized by the
+    // surface area of the root node
+    float               sibling_overlap     = 0.0f;
+
+    // References / input primitives (> 1 with spatial splits)
+    float               duplication_ratio   = 1.0f;
+
+    size_t              node_bytes          = 0;
+    size_t              index_bytes         = 0;
+    size_t              primitive_bytes     = 0;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Compute stats for an index BVH. num_input_primitives is the number of
+// primitives the builder was called with
+//
+
+template <typename BVH>
+bvh_stats compute_bvh_stats(
+        BVH const&  bvh,
+        size_t      num_input_primitives,
+        float       traversal_cost = 1.0f,
+        float       intersection_cost = 1.0f
+        )
+{
+    using primitive_type = typename BVH::primitive_type;
+
+    bvh_stats result;
+
+    result.num_nodes       = bvh.num_nodes();
+    result.num_primitives  = num_input_primitives;
+    result.node_bytes      = bvh.num_nodes() * sizeof(bvh_node);
+    result.index_bytes     = bvh.indices().size() * sizeof(unsigned);
+    result.primitive_bytes = bvh.num_primitives() * sizeof(primitive_type);
+
+    if (bvh.num_nodes() == 0)
+    {
+        return result;
+    }
+
+    auto surface_area = [](aabb const& box)
+    {
+        vec3 s = max(box.max - box.min, vec3(0.0f));
+        return 2.0f * (s.x * s.y + s.y * s.z + s.z * s.x);
+    };
+
+    auto const& nodes = bvh.nodes();
+
+    float root_area = surface_area(nodes[0].get_bounds());
+    float inv_root_area = root_area > 0.0f ? 1.0f / root_area : 0.0f;
+
+    // (node index, depth)
+    std::vector<std::pair<unsigned, size_t>> stack;
+    stack.emplace_back(0, 0);
+
+    while (!stack.empty())
+    {
+        auto index = stack.back().first;
+        auto depth = stack.back().second;
+        stack.pop_back();
+
+        auto const& n = nodes[index];
+        float area = surface_area(n.get_bounds()) * inv_root_area;
+
+        result.max_depth = std::max(result.max_depth, depth);
+
+        if (n.is_leaf())
+        {
+            size_t num_prims = n.get_num_primitives();
+
+            ++result.num_leaves;
+            result.num_references += num_prims;
+            result.sah_cost += area * num_prims * intersection_cost;
+
+            if (result.depth_histogram.size() <= depth)
+            {
+                result.depth_histogram.resize(depth + 1, 0);
+            }
+            ++result.depth_histogram[depth];
+
+            if (result.leaf_size_histogram.size() <= num_prims)
+            {
+                result.leaf_size_histogram.resize(num_prims + 1, 0);
+            }
+            ++result.leaf_size_histogram[num_prims];
+        }
+        else
+        {
+            ++result.num_inner_nodes;
+            result.sah_cost += area * traversal_cost;
+
+            aabb const& l = nodes[n.get_child(0)].get_bounds();
+            aabb const& r = nodes[n.get_child(1)].get_bounds();
+            aabb overlap(max(l.min, r.min), min(l.max, r.max));
+
+            if (overlap.min.x <= overlap.max.x && overlap.min.y <= overlap.max.y && overlap.min.z <= overlap.max.z)
+            {
+                result.sibling_overlap += surface_area(overlap) * inv_root_area;
+            }
+
+            stack.emplace_back(n.get_child(0), depth + 1);
+            stack.emplace_back(n.get_child(1), depth + 1);
+        }
+    }
+
+    if (num_input_primitives > 0)
+    {
+        result.duplication_ratio = result.num_references / static_cast<float>(num_input_primitives);
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Human readable report and JSON dump
+//
+
+void print_bvh_stats(std::ostream& out, bvh_stats const& stats);
+void write_bvh_stats_json(std::ostream& out, bvh_stats const& stats);
+
+} // namespace visionaray
@@ -0,0 +1,151 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <istream>
+#include <string>
+
+#include "camera_path.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static vec3 catmull_rom(vec3 const& p0, vec3 const& p1, vec3 const& p2, vec3 const& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return 0.5f * ( 2.0f * p1
+                  + (p2 - p0) * t
+                  + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                  + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3 );
+}
+
+// Rotate v about the unit vector axis (Rodrigues' formula)
+static vec3 rotate(vec3 const& v, vec3 const& axis, float angle)
+{
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    return v * c + cross(axis, v) * s + axis * dot(axis, v) * (1.0f - c);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+bool load_camera_path(std::string const& filename, std::vector<camera_view>& views)
+{
+    std::ifstream in(filename);
+
+    if (!in.good())
+    {
+        return false;
+    }
+
+    views.clear();
+
+    for (;;)
+    {
+        in >> std::ws;
+
+        if (in.eof())
+        {
+            break;
+        }
+
+        if (in.peek() == '#')
+        {
+            std::string comment;
+            std::getline(in, comment);
+            continue;
+        }
+
+        camera_view view;
+        in >> view.eye >> std::ws >> view.center >> std::ws >> view.up;
+
+        if (in.fail())
+        {
+            return false;
+        }
+
+        views.push_back(view);
+    }
+
+    return !views.empty();
+}
+
+std::vector<camera_view> interpolate_camera_path(std::vector<camera_view> const& keys, size_t num_frames)
+{
+    if (keys.empty() || num_frames <= keys.size())
+    {
+        return keys;
+    }
+
+    std::vector<camera_view> result(num_frames);
+
+    size_t last = keys.size() - 1;
+
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        // Frames are spread evenly from the first to the last keyframe
+        float x = static_cast<float>(i) * last / (num_frames - 1);
+        size_t k = std::min(static_cast<size_t>(x), last == 0 ? 0 : last - 1);
+        float t = x - k;
+
+        auto const& k0 = keys[k == 0 ? 0 : k - 1];
+        auto const& k1 = keys[k];
+        auto const& k2 = keys[std::min(k + 1, last)];
+        auto const& k3 = keys[std::min(k + 2, last)];
+
+        result[i].eye    = catmull_rom(k0.eye,    k1.eye,    k2.eye,    k3.eye,    t);
+        result[i].center = catmull_rom(k0.center, k1.center, k2.center, k3.center, t);
+        result[i].up     = normalize(k1.up * (1.0f - t) + k2.up * t);
+    }
+
+    return result;
+}
+
+std::vector<camera_view> make_turntable(camera_view const& start, size_t num_frames)
+{
+    std::vector<camera_view> result(num_frames);
+
+    vec3 up = normalize(start.up);
+
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        float angle = 2.0f * constants::pi<float>() * i / num_frames;
+
+        result[i].eye    = start.center + rotate(start.eye - start.center, up, angle);
+        result[i].center = start.center;
+        result[i].up     = up;
+    }
+
+    return result;
+}
+
+std::string numbered_filename(std::string const& filename, size_t index, size_t count)
+{
+    size_t digits = std::max<size_t>(4, std::to_string(count).size());
+
+    std::string number = std::to_string(index);
+    number.insert(0, digits - std::min(digits, number.size()), '0');
+
+    size_t dot = filename.find_last_of('.');
+    size_t slash = filename.find_last_of('/');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return filename + '_' + number;
+    }
+
+    return filename.substr(0, dot) + '_' + number + filename.substr(dot);
+}
+
+} // namespace visionaray
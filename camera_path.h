@@ -0,0 +1,41 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <visionaray/math/math.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Camera views for batch rendering
+//
+
+struct camera_view
+{
+    vec3 eye;
+    vec3 center;
+    vec3 up;
+};
+
+// Read a camera path: eye, center and up per view in the format of the
+// -camera file (i.e. a camera file is a path with one view). Lines starting
+// with '#' are ignored
+bool load_camera_path(std::string const& filename, std::vector<camera_view>& views);
+
+// num_frames views along a Catmull-Rom spline through the keyframes (eye
+// and center, up is interpolated linearly). Returns the keyframes if
+// num_frames <= keys.size()
+std::vector<camera_view> interpolate_camera_path(std::vector<camera_view> const& keys, size_t num_frames);
+
+// num_frames views turning once about the up axis through the center
+std::vector<camera_view> make_turntable(camera_view const& start, size_t num_frames);
+
+// "name.png" -> "name_0007.png", with at least four digits
+std::string numbered_filename(std::string const& filename, size_t index, size_t count);
+
+} // namespace visionaray
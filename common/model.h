@@ -6,6 +6,8 @@
 #ifndef VSNRAY_COMMON_MODEL_H
 #define VSNRAY_COMMON_MODEL_H 1
 
+#include <cstddef>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -65,16 +67,49 @@ public:
     std::shared_ptr<sg::node> scene_graph = nullptr;
 
     // These lists will be filled if the file format is so simple
-    // that no scene graph is required (i.e. scene_graph == nullptr)
+    // that no scene graph is required (i.e. scene_graph == nullptr).
+    // tex_coords is empty if no material references a texture
     triangle_list   primitives;
     normal_list     shading_normals;
-    normal_list     geometric_normals;
     tex_coord_list  tex_coords;
     color_list      colors;
     mat_list        materials;
     tex_map         texture_map;
     tex_list        textures;
     aabb            bbox;
+
+    // Texture file per material (empty if untextured)
+    std::vector<std::string> texture_filenames;
+
+    // If false, texture files are only recorded in texture_filenames and
+    // textures holds dummy textures
+    bool            load_textures = true;
+
+    // Load-time deduplication: weld vertices closer than weld_epsilon
+    // (0 = off) and drop usemtl groups that repeat an earlier group with
+    // the same material and identical triangles
+    float           weld_epsilon = 0.0f;
+    bool            dedup_groups = false;
+
+    struct dedup_stats
+    {
+        size_t      welded_vertices     = 0;    // vertices merged into an earlier one
+        size_t      collapsed_triangles = 0;    // triangles degenerate after welding
+        size_t      duplicate_groups    = 0;
+        size_t      duplicate_triangles = 0;
+        size_t      bytes_saved         = 0;    // primitives and per-triangle attributes
+    };
+
+    // Filled by the loader
+    dedup_stats     dedup;
+
+    // If set, the obj loader hands primitives to primitive_sink in chunks of
+    // about sink_chunk_size instead of keeping them (prim ids stay global).
+    // Per-triangle attributes are not kept then and dedup_groups is ignored
+    // (callers reject it); bbox still covers all primitives
+    std::function<void(triangle_list&)> primitive_sink;
+    size_t          sink_chunk_size = size_t(1) << 20;
+    size_t          num_sunk_primitives = 0;
 };
 
 } // visionaray
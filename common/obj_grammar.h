@@ -6,7 +6,9 @@
 #ifndef VSNRAY_COMMON_OBJ_GRAMMAR_H
 #define VSNRAY_COMMON_OBJ_GRAMMAR_H 1
 
+#include <memory_resource>
 #include <string>
+#include <vector>
 
 #include <boost/fusion/include/adapt_struct.hpp>
 #include <boost/fusion/include/define_struct.hpp>
@@ -15,7 +17,6 @@
 
 #include <visionaray/math/forward.h>
 #include <visionaray/math/vector.h>
-#include <visionaray/aligned_vector.h>
 
 //-------------------------------------------------------------------------------------------------
 // boost::fusion-adapt/define some structs for parsing
@@ -50,11 +51,14 @@ namespace visionaray
 //-------------------------------------------------------------------------------------------------
 // Typedefs (TODO: not in namespace visionaray!)
 //
+// Parse-time temporaries only, allocated from a per-file arena
+// (std::pmr::monotonic_buffer_resource) that is released in one shot
+//
 
-using vertex_vector     = aligned_vector<vec3>;
-using tex_coord_vector  = aligned_vector<vec2>;
-using normal_vector     = aligned_vector<vec3>;
-using face_vector       = aligned_vector<face_index_t>;
+using vertex_vector     = std::pmr::vector<vec3>;
+using tex_coord_vector  = std::pmr::vector<vec2>;
+using normal_vector     = std::pmr::vector<vec3>;
+using face_vector       = std::pmr::vector<face_index_t>;
 
 
 //-------------------------------------------------------------------------------------------------
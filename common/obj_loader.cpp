@@ -3,12 +3,26 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <ostream>
 #include <map>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <boost/algorithm/string.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/spirit/include/qi.hpp>
@@ -19,6 +33,9 @@
 #include <visionaray/math/vector.h>
 #include <visionaray/texture/texture.h>
 
+#include <parallel_for.h>
+#include <texture_convert.h>
+
 #include "image.h"
 #include "make_texture.h"
 #include "model.h"
@@ -44,6 +61,159 @@ inline Int remap_index(Int idx, Int size)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Trim blanks without copying
+//
+
+static string_ref trim(string_ref str)
+{
+    auto blank = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+    while (!str.empty() && blank(str.front()))
+    {
+        str.remove_prefix(1);
+    }
+
+    while (!str.empty() && blank(str.back()))
+    {
+        str.remove_suffix(1);
+    }
+
+    return str;
+}
+
+static std::string_view to_string_view(string_ref str)
+{
+    return std::string_view(str.data(), str.length());
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Count records by type in a single pass over the mapped file, used to
+// size the parse arena and the output containers up front
+//
+
+struct obj_record_counts
+{
+    size_t vertices         = 0;
+    size_t tex_coords       = 0;
+    size_t normals          = 0;
+    size_t faces            = 0;
+
+    // Triangles after fan triangulation, and those whose first corner
+    // references a tex coord / normal
+    size_t triangles        = 0;
+    size_t tex_triangles    = 0;
+    size_t normal_triangles = 0;
+};
+
+static bool is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static bool is_eol(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+// p points behind "f", returns the end of the corner list
+static char const* count_face(char const* p, char const* end, obj_record_counts& counts)
+{
+    size_t corners = 0;
+    bool has_tex_coord = false;
+    bool has_normal = false;
+
+    for (;;)
+    {
+        while (p != end && is_blank(*p))
+        {
+            ++p;
+        }
+
+        if (p == end || is_eol(*p) || *p == '#')
+        {
+            break;
+        }
+
+        char const* first = p;
+
+        while (p != end && !is_blank(*p) && !is_eol(*p))
+        {
+            ++p;
+        }
+
+        // v, v/vt, v//vn, v/vt/vn
+        if (corners == 0)
+        {
+            auto slash1 = static_cast<char const*>(std::memchr(first, '/', p - first));
+
+            if (slash1 != nullptr)
+            {
+                auto slash2 = static_cast<char const*>(std::memchr(slash1 + 1, '/', p - slash1 - 1));
+
+                has_tex_coord = slash1 + 1 != p && slash1 + 1 != slash2;
+                has_normal = slash2 != nullptr && slash2 + 1 != p;
+            }
+        }
+
+        ++corners;
+    }
+
+    ++counts.faces;
+
+    if (corners >= 3)
+    {
+        counts.triangles        += corners - 2;
+        counts.tex_triangles    += has_tex_coord ? corners - 2 : 0;
+        counts.normal_triangles += has_normal ? corners - 2 : 0;
+    }
+
+    return p;
+}
+
+static obj_record_counts count_records(string_ref text)
+{
+    obj_record_counts counts;
+
+    char const* p = text.data();
+    char const* end = text.data() + text.size();
+
+    while (p != end)
+    {
+        while (p != end && is_blank(*p))
+        {
+            ++p;
+        }
+
+        if (end - p >= 2)
+        {
+            if (p[0] == 'v' && is_blank(p[1]))
+            {
+                ++counts.vertices;
+            }
+            else if (p[0] == 'v' && p[1] == 't')
+            {
+                ++counts.tex_coords;
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                ++counts.normals;
+            }
+            else if (p[0] == 'f' && is_blank(p[1]))
+            {
+                p = count_face(p + 1, end, counts);
+            }
+        }
+
+        auto eol = static_cast<char const*>(std::memchr(p, '\n', end - p));
+        p = eol != nullptr ? eol + 1 : end;
+    }
+
+    return counts;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Store a triangle and assign visionaray-internal ids
 //
@@ -65,7 +235,7 @@ static bool store_triangle(model& result, vertex_vector const& vertices, int i1,
     }
     else
     {
-        tri.prim_id = static_cast<unsigned>(result.primitives.size());
+        tri.prim_id = static_cast<unsigned>(result.num_sunk_primitives + result.primitives.size());
         tri.geom_id = result.materials.size() == 0 ? 0 : static_cast<unsigned>(result.materials.size() - 1);
         result.primitives.push_back(tri);
     }
@@ -74,6 +244,125 @@ static bool store_triangle(model& result, vertex_vector const& vertices, int i1,
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Weld vertices closer than epsilon with a spatial hash over cells of size
+// epsilon. Each vertex maps to the first vertex within reach, which is
+// searched in the 27 cells around it. Grows with the vertex list, so faces
+// can refer to vertices parsed so far
+//
+
+class vertex_welder
+{
+public:
+
+    vertex_welder(float epsilon, size_t num_vertices, std::pmr::memory_resource* arena)
+        : epsilon_(epsilon)
+        , cells_(arena)
+        , next_(arena)
+        , canonical_(arena)
+    {
+        cells_.reserve(num_vertices);
+        next_.reserve(num_vertices);
+        canonical_.reserve(num_vertices);
+    }
+
+    // Weld the vertices appended since the last call
+    void update(vertex_vector const& vertices, size_t& welded)
+    {
+        for (size_t i = canonical_.size(); i < vertices.size(); ++i)
+        {
+            auto index = static_cast<int>(i);
+            int found = lookup(vertices, vertices[i]);
+
+            canonical_.push_back(found >= 0 ? found : index);
+            next_.push_back(-1);
+
+            if (found >= 0)
+            {
+                ++welded;
+                continue;
+            }
+
+            auto r = cells_.insert({ cell_key(cell_of(vertices[i])), index });
+            if (!r.second)
+            {
+                next_[i] = r.first->second;
+                r.first->second = index;
+            }
+        }
+    }
+
+    int operator()(int index) const
+    {
+        return canonical_[index];
+    }
+
+private:
+
+    struct cell
+    {
+        int64_t x;
+        int64_t y;
+        int64_t z;
+    };
+
+    float                                   epsilon_;
+    std::pmr::unordered_map<uint64_t, int>  cells_;     // cell -> last vertex inserted
+    std::pmr::vector<int>                   next_;      // chain of vertices per cell
+    std::pmr::vector<int>                   canonical_;
+
+    cell cell_of(vec3 const& v) const
+    {
+        return {
+            static_cast<int64_t>(std::floor(v.x / epsilon_)),
+            static_cast<int64_t>(std::floor(v.y / epsilon_)),
+            static_cast<int64_t>(std::floor(v.z / epsilon_))
+            };
+    }
+
+    // 21 bits per axis, wrapped coordinates only lengthen the chains
+    static uint64_t cell_key(cell const& c)
+    {
+        uint64_t mask = (uint64_t(1) << 21) - 1;
+        return (uint64_t(c.x) & mask) | ((uint64_t(c.y) & mask) << 21) | ((uint64_t(c.z) & mask) << 42);
+    }
+
+    int lookup(vertex_vector const& vertices, vec3 const& v) const
+    {
+        cell c = cell_of(v);
+
+        int result = -1;
+
+        for (int64_t z = c.z - 1; z <= c.z + 1; ++z)
+        {
+            for (int64_t y = c.y - 1; y <= c.y + 1; ++y)
+            {
+                for (int64_t x = c.x - 1; x <= c.x + 1; ++x)
+                {
+                    auto it = cells_.find(cell_key({ x, y, z }));
+
+                    if (it == cells_.end())
+                    {
+                        continue;
+                    }
+
+                    // Lowest index within reach, independent of cell order
+                    for (int j = it->second; j >= 0; j = next_[j])
+                    {
+                        if ((result < 0 || j < result) && length(vertices[j] - v) <= epsilon_)
+                        {
+                            result = j;
+                        }
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+};
+
+
 //-------------------------------------------------------------------------------------------------
 // Store obj faces (i.e. triangle fans) in vertex|tex_coords|normals lists
 //
@@ -83,21 +372,35 @@ static void store_faces(
         vertex_vector const&    vertices,
         tex_coord_vector const& tex_coords,
         normal_vector const&    normals,
-        face_vector const&      faces
+        face_vector const&      faces,
+        vertex_welder const*    welder
         )
 {
 
     auto vertices_size = static_cast<int>(vertices.size());
+
+    // Welded vertex index
+    auto vertex = [&](face_index_t const& fi)
+    {
+        auto i = remap_index(fi.vertex_index, vertices_size);
+        return welder != nullptr ? (*welder)(i) : i;
+    };
+
     size_t last = 2;
-    auto i1 = remap_index(faces[0].vertex_index, vertices_size);
+    auto i1 = vertex(faces[0]);
 
     while (last != faces.size())
     {
         // triangle
-        auto i2 = remap_index(faces[last - 1].vertex_index, vertices_size);
-        auto i3 = remap_index(faces[last].vertex_index, vertices_size);
+        auto i2 = vertex(faces[last - 1]);
+        auto i3 = vertex(faces[last]);
 
-        if (store_triangle(result, vertices, i1, i2, i3))
+        if (welder != nullptr && (i1 == i2 || i2 == i3 || i1 == i3))
+        {
+            // Collapsed by welding, not worth a warning
+            ++result.dedup.collapsed_triangles;
+        }
+        else if (store_triangle(result, vertices, i1, i2, i3))
         {
 
             // texture coordinates
@@ -133,29 +436,332 @@ static void store_faces(
 
 
 //-------------------------------------------------------------------------------------------------
-// aabb of a list of triangles
+// Triangle post-pass: bounds in one sweep over the triangle list. The SSE path
+// handles four triangles per iteration (the AoS triangles are transposed on
+// load), chunks are reduced into one box. Geometric normals are not stored,
+// they follow from the triangle edges at hit time
 //
 
-inline aabb bounds(model::triangle_list const& tris)
+static void finish_triangles_scalar(
+        model::triangle_type const* tris,
+        size_t                      count,
+        aabb&                       box
+        )
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const& tri = tris[i];
+
+        box = combine(box, tri.v1);
+        box = combine(box, tri.v1 + tri.e1);
+        box = combine(box, tri.v1 + tri.e2);
+    }
+}
+
+#if defined(__SSE2__)
+static void finish_triangles_sse(
+        model::triangle_type const* tris,
+        size_t                      count,
+        aabb&                       box
+        )
+{
+    __m128 min_x = _mm_set1_ps( FLT_MAX);
+    __m128 min_y = _mm_set1_ps( FLT_MAX);
+    __m128 min_z = _mm_set1_ps( FLT_MAX);
+    __m128 max_x = _mm_set1_ps(-FLT_MAX);
+    __m128 max_y = _mm_set1_ps(-FLT_MAX);
+    __m128 max_z = _mm_set1_ps(-FLT_MAX);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        auto const* t = tris + i;
+
+        __m128 v1x = _mm_setr_ps(t[0].v1.x, t[1].v1.x, t[2].v1.x, t[3].v1.x);
+        __m128 v1y = _mm_setr_ps(t[0].v1.y, t[1].v1.y, t[2].v1.y, t[3].v1.y);
+        __m128 v1z = _mm_setr_ps(t[0].v1.z, t[1].v1.z, t[2].v1.z, t[3].v1.z);
+        __m128 e1x = _mm_setr_ps(t[0].e1.x, t[1].e1.x, t[2].e1.x, t[3].e1.x);
+        __m128 e1y = _mm_setr_ps(t[0].e1.y, t[1].e1.y, t[2].e1.y, t[3].e1.y);
+        __m128 e1z = _mm_setr_ps(t[0].e1.z, t[1].e1.z, t[2].e1.z, t[3].e1.z);
+        __m128 e2x = _mm_setr_ps(t[0].e2.x, t[1].e2.x, t[2].e2.x, t[3].e2.x);
+        __m128 e2y = _mm_setr_ps(t[0].e2.y, t[1].e2.y, t[2].e2.y, t[3].e2.y);
+        __m128 e2z = _mm_setr_ps(t[0].e2.z, t[1].e2.z, t[2].e2.z, t[3].e2.z);
+
+        // v1, v2 = v1 + e1, v3 = v1 + e2
+        __m128 v2x = _mm_add_ps(v1x, e1x);
+        __m128 v2y = _mm_add_ps(v1y, e1y);
+        __m128 v2z = _mm_add_ps(v1z, e1z);
+        __m128 v3x = _mm_add_ps(v1x, e2x);
+        __m128 v3y = _mm_add_ps(v1y, e2y);
+        __m128 v3z = _mm_add_ps(v1z, e2z);
+
+        min_x = _mm_min_ps(min_x, _mm_min_ps(v1x, _mm_min_ps(v2x, v3x)));
+        min_y = _mm_min_ps(min_y, _mm_min_ps(v1y, _mm_min_ps(v2y, v3y)));
+        min_z = _mm_min_ps(min_z, _mm_min_ps(v1z, _mm_min_ps(v2z, v3z)));
+        max_x = _mm_max_ps(max_x, _mm_max_ps(v1x, _mm_max_ps(v2x, v3x)));
+        max_y = _mm_max_ps(max_y, _mm_max_ps(v1y, _mm_max_ps(v2y, v3y)));
+        max_z = _mm_max_ps(max_z, _mm_max_ps(v1z, _mm_max_ps(v2z, v3z)));
+    }
+
+    if (i > 0)
+    {
+        alignas(16) float lo[3][4];
+        alignas(16) float hi[3][4];
+        _mm_store_ps(lo[0], min_x);
+        _mm_store_ps(lo[1], min_y);
+        _mm_store_ps(lo[2], min_z);
+        _mm_store_ps(hi[0], max_x);
+        _mm_store_ps(hi[1], max_y);
+        _mm_store_ps(hi[2], max_z);
+
+        for (int k = 0; k < 4; ++k)
+        {
+            box = combine(box, vec3(lo[0][k], lo[1][k], lo[2][k]));
+            box = combine(box, vec3(hi[0][k], hi[1][k], hi[2][k]));
+        }
+    }
+
+    finish_triangles_scalar(tris + i, count - i, box);
+}
+#endif
+
+// Returns the bounds
+static aabb finish_triangles(model::triangle_list const& tris)
 {
     aabb result;
     result.invalidate();
 
-    for (auto const& tri : tris)
+    std::mutex mtx;
+
+    parallel_for(0, tris.size(), 1 << 16, [&](size_t first, size_t last)
     {
-        auto v1 = tri.v1;
-        auto v2 = tri.v1 + tri.e1;
-        auto v3 = tri.v1 + tri.e2;
+        aabb box;
+        box.invalidate();
 
-        result = combine(result, v1);
-        result = combine(result, v2);
-        result = combine(result, v3);
-    }
+#if defined(__SSE2__)
+        finish_triangles_sse(tris.data() + first, last - first, box);
+#else
+        finish_triangles_scalar(tris.data() + first, last - first, box);
+#endif
+
+        std::lock_guard<std::mutex> lock(mtx);
+        result = combine(result, box);
+    });
 
     return result;
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Hand the primitives stored so far to the model's primitive sink
+//
+
+static void flush_primitives(model& mod)
+{
+    if (mod.primitives.empty())
+    {
+        return;
+    }
+
+    mod.bbox.insert(finish_triangles(mod.primitives));
+
+    mod.primitive_sink(mod.primitives);
+
+    mod.num_sunk_primitives += mod.primitives.size();
+    mod.primitives.clear();
+    mod.tex_coords.clear();
+    mod.shading_normals.clear();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Remove usemtl groups (runs of primitives with the same geom_id) that repeat
+// an earlier group: same material name and bitwise identical triangles,
+// including their tex coords and shading normals if there are three per
+// triangle (groups that differ only in their mapping are kept). These are
+// compacted along, prim ids are reassigned
+//
+
+struct triangle_attributes
+{
+    model const&    mod;
+    bool            tex_coords;
+    bool            shading_normals;
+};
+
+static bool same_bytes(void const* a, void const* b, size_t size)
+{
+    return std::memcmp(a, b, size) == 0;
+}
+
+static bool same_triangle(triangle_attributes const& attr, size_t a, size_t b)
+{
+    auto const& ta = attr.mod.primitives[a];
+    auto const& tb = attr.mod.primitives[b];
+
+    return same_bytes(&ta.v1, &tb.v1, sizeof(ta.v1))
+        && same_bytes(&ta.e1, &tb.e1, sizeof(ta.e1))
+        && same_bytes(&ta.e2, &tb.e2, sizeof(ta.e2))
+        && (!attr.tex_coords || same_bytes(
+                attr.mod.tex_coords.data() + a * 3,
+                attr.mod.tex_coords.data() + b * 3,
+                3 * sizeof(model::tex_coord_type)
+                ))
+        && (!attr.shading_normals || same_bytes(
+                attr.mod.shading_normals.data() + a * 3,
+                attr.mod.shading_normals.data() + b * 3,
+                3 * sizeof(model::normal_type)
+                ));
+}
+
+static uint64_t hash_triangles(triangle_attributes const& attr, size_t first, size_t count)
+{
+    // FNV-1a over the vertex data and attributes, ids excluded
+    uint64_t h = 14695981039346656037ull;
+
+    auto add = [&](void const* data, size_t size)
+    {
+        auto bytes = static_cast<unsigned char const*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            h = (h ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    for (size_t i = first; i < first + count; ++i)
+    {
+        auto const& tri = attr.mod.primitives[i];
+        add(&tri.v1, sizeof(tri.v1));
+        add(&tri.e1, sizeof(tri.e1));
+        add(&tri.e2, sizeof(tri.e2));
+
+        if (attr.tex_coords)
+        {
+            add(attr.mod.tex_coords.data() + i * 3, 3 * sizeof(model::tex_coord_type));
+        }
+
+        if (attr.shading_normals)
+        {
+            add(attr.mod.shading_normals.data() + i * 3, 3 * sizeof(model::normal_type));
+        }
+    }
+
+    return h;
+}
+
+static void remove_duplicate_groups(model& mod)
+{
+    auto& prims = mod.primitives;
+
+    bool compact_tex_coords = mod.tex_coords.size() == prims.size() * 3;
+    bool compact_normals = mod.shading_normals.size() == prims.size() * 3;
+
+    triangle_attributes attr{ mod, compact_tex_coords, compact_normals };
+
+    std::unordered_multimap<uint64_t, size_t> kept; // hash -> first primitive
+    std::vector<size_t> group_size(prims.size(), 0);
+    std::vector<char> keep(prims.size(), 1);
+
+    for (size_t first = 0; first < prims.size(); )
+    {
+        size_t last = first + 1;
+        while (last < prims.size() && prims[last].geom_id == prims[first].geom_id)
+        {
+            ++last;
+        }
+
+        size_t count = last - first;
+        group_size[first] = count;
+
+        auto const& name = mod.materials[prims[first].geom_id].name();
+        uint64_t h = hash_triangles(attr, first, count);
+        auto range = kept.equal_range(h);
+
+        bool duplicate = std::any_of(range.first, range.second, [&](std::pair<uint64_t const, size_t> const& k)
+        {
+            size_t other = k.second;
+
+            if (group_size[other] != count || mod.materials[prims[other].geom_id].name() != name)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (!same_triangle(attr, first + i, other + i))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        });
+
+        if (duplicate)
+        {
+            std::fill(keep.begin() + first, keep.begin() + last, 0);
+            ++mod.dedup.duplicate_groups;
+            mod.dedup.duplicate_triangles += count;
+        }
+        else
+        {
+            kept.insert({ h, first });
+        }
+
+        first = last;
+    }
+
+    if (mod.dedup.duplicate_triangles == 0)
+    {
+        return;
+    }
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        if (!keep[i])
+        {
+            continue;
+        }
+
+        prims[n] = prims[i];
+        prims[n].prim_id = static_cast<unsigned>(n);
+
+        for (size_t j = 0; j < 3; ++j)
+        {
+            if (compact_tex_coords)
+            {
+                mod.tex_coords[n * 3 + j] = mod.tex_coords[i * 3 + j];
+            }
+
+            if (compact_normals)
+            {
+                mod.shading_normals[n * 3 + j] = mod.shading_normals[i * 3 + j];
+            }
+        }
+
+        ++n;
+    }
+
+    prims.resize(n);
+    prims.shrink_to_fit();
+
+    if (compact_tex_coords)
+    {
+        mod.tex_coords.resize(n * 3);
+        mod.tex_coords.shrink_to_fit();
+    }
+
+    if (compact_normals)
+    {
+        mod.shading_normals.resize(n * 3);
+        mod.shading_normals.shrink_to_fit();
+    }
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Obj material
 //
@@ -175,15 +781,19 @@ struct mtl
 };
 
 
+// Transparent comparator: usemtl looks materials up by string_view
+using mtl_library = std::map<std::string, mtl, std::less<>>;
+
+
 //-------------------------------------------------------------------------------------------------
 // Parse mtllib
 //
 
-static void parse_mtl(std::string const& filename, std::map<std::string, mtl>& matlib, obj_grammar const& grammar)
+static void parse_mtl(std::string const& filename, mtl_library& matlib, obj_grammar const& grammar)
 {
     boost::iostreams::mapped_file_source file(filename);
 
-    std::map<std::string, mtl>::iterator mtl_it = matlib.end();
+    mtl_library::iterator mtl_it = matlib.end();
 
     string_ref text(file.data(), file.size());
     auto it = text.cbegin();
@@ -194,9 +804,8 @@ static void parse_mtl(std::string const& filename, std::map<std::string, mtl>& m
     {
         if ( qi::phrase_parse(it, text.cend(), grammar.r_newmtl, qi::blank, mtl_name) )
         {
-            std::string name(mtl_name.begin(), mtl_name.length());
-            boost::trim(name);
-            auto r = matlib.insert({ name, mtl() });
+            auto name = trim(mtl_name);
+            auto r = matlib.insert({ std::string(name.data(), name.length()), mtl() });
             if (!r.second)
             {
                 // Material already exists...
@@ -307,7 +916,7 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
 {
     std::vector<std::string> parsed_matlibs;
 
-    std::map<std::string, mtl> matlib;
+    mtl_library matlib;
 
     size_t geom_id = 0;
 
@@ -319,17 +928,77 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
     string_ref mtl_file;
     string_ref mtl_name;
 
+    // First pass: count records of all files, so that the output lists are
+    // allocated once at their final size and filled in place
+    std::vector<obj_record_counts> file_counts;
+    obj_record_counts total;
+
     for (auto filename : filenames)
     {
         boost::iostreams::mapped_file_source file(filename);
 
+        file_counts.push_back(count_records(string_ref(file.data(), file.size())));
+
+        total.triangles        += file_counts.back().triangles;
+        total.tex_triangles    += file_counts.back().tex_triangles;
+        total.normal_triangles += file_counts.back().normal_triangles;
+    }
+
+    // Degenerate triangles are rejected later, so these are upper bounds.
+    // If present, tex_coords is padded to three per triangle at the end
+    if (mod.primitive_sink)
+    {
+        // A face may overshoot the chunk size by its fan
+        mod.primitives.reserve(mod.sink_chunk_size + 64);
+    }
+    else
+    {
+        mod.primitives.reserve(mod.primitives.size() + total.triangles);
+        mod.shading_normals.reserve(mod.shading_normals.size() + total.normal_triangles * 3);
+
+        if (total.tex_triangles > 0)
+        {
+            mod.tex_coords.reserve(mod.tex_coords.size() + total.triangles * 3);
+        }
+    }
+
+    // Second pass: parse
+    for (size_t file_index = 0; file_index < filenames.size(); ++file_index)
+    {
+        auto const& filename = filenames[file_index];
+        auto const& counts = file_counts[file_index];
+
+        boost::iostreams::mapped_file_source file(filename);
+
         string_ref text(file.data(), file.size());
         auto it = text.cbegin();
 
-        vertex_vector    vertices;
-        tex_coord_vector tex_coords;
-        normal_vector    normals;
-        face_vector      faces;
+        // All parse temporaries of this file come from one arena, sized so
+        // that the reserved lists fit into its initial buffer. Declared
+        // before the lists so that it outlives them and is released at once
+        size_t arena_size = counts.vertices * sizeof(vec3)
+                          + counts.tex_coords * sizeof(vec2)
+                          + counts.normals * sizeof(vec3)
+                          + 64 * sizeof(face_index_t)
+                          + 256; // alignment slack
+        std::pmr::monotonic_buffer_resource arena(arena_size);
+
+        vertex_vector    vertices(&arena);
+        tex_coord_vector tex_coords(&arena);
+        normal_vector    normals(&arena);
+        face_vector      faces(&arena);
+
+        vertices.reserve(counts.vertices);
+        tex_coords.reserve(counts.tex_coords);
+        normals.reserve(counts.normals);
+        faces.reserve(64);
+
+        std::unique_ptr<vertex_welder> welder;
+
+        if (mod.weld_epsilon > 0.0f)
+        {
+            welder.reset(new vertex_welder(mod.weld_epsilon, counts.vertices, &arena));
+        }
 
         while (it != text.cend())
         {
@@ -378,15 +1047,16 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
             }
             else if ( qi::phrase_parse(it, text.cend(), grammar.r_usemtl, qi::blank, mtl_name) )
             {
-                std::string name(mtl_name.begin(), mtl_name.length());
-                boost::trim(name);
-                auto mat_it = matlib.find(name);
+                auto name = trim(mtl_name);
+                auto mat_it = matlib.find(to_string_view(name));
                 if (mat_it != matlib.end())
                 {
                     typedef model::texture_type tex_type;
 
                     add_material(mod.materials, mat_it->second, name);
 
+                    std::string texture_filename;
+
                     if (!mat_it->second.map_kd.empty()) // File path specified in mtl file
                     {
                         std::string tex_filename;
@@ -418,6 +1088,11 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
                         }
 
                         if (boost::filesystem::exists(tex_filename))
+                        {
+                            texture_filename = tex_filename;
+                        }
+
+                        if (boost::filesystem::exists(tex_filename) && mod.load_textures)
                         {
                             // Load the texture if we haven't done so yet
                             auto tex_it = mod.texture_map.find(mat_it->second.map_kd);
@@ -427,7 +1102,7 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
                                 if (img.load(tex_filename))
                                 {
                                     model::texture_type tex(img.width(), img.height());
-                                    make_texture(tex, img);
+                                    make_texture_rgba8(tex, img);
 
                                     mod.texture_map.insert(std::make_pair(mat_it->second.map_kd, std::move(tex)));
                                     // Will be ref()'d below
@@ -447,12 +1122,14 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
                                 mod.textures.push_back(tex_type::ref_type(loaded_tex));
                             }
                         }
-                        else
+                        else if (texture_filename.empty())
                         {
                             std::cerr << "Warning: file does not exist: " << tex_filename << '\n';
                         }
                     }
 
+                    mod.texture_filenames.push_back(texture_filename);
+
                     // if no texture was loaded, insert a dummy
                     if (mod.textures.size() < mod.materials.size())
                     {
@@ -479,7 +1156,17 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
             }
             else if ( qi::phrase_parse(it, text.cend(), grammar.r_face, qi::blank, faces) )
             {
-                store_faces(mod, vertices, tex_coords, normals, faces);
+                if (welder != nullptr)
+                {
+                    welder->update(vertices, mod.dedup.welded_vertices);
+                }
+
+                store_faces(mod, vertices, tex_coords, normals, faces, welder.get());
+
+                if (mod.primitive_sink && mod.primitives.size() >= mod.sink_chunk_size)
+                {
+                    flush_primitives(mod);
+                }
             }
             else if ( qi::phrase_parse(it, text.cend(), grammar.r_unhandled, qi::blank) )
             {
@@ -496,6 +1183,11 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
             mod.materials.emplace_back(model::material_type());
         }
 
+        for (size_t i = mod.texture_filenames.size(); i < mod.materials.size(); ++i)
+        {
+            mod.texture_filenames.emplace_back();
+        }
+
         // See that there is a (at least dummy) texture for each geometry
         for (size_t i = mod.textures.size(); i <= geom_id; ++i)
         {
@@ -503,20 +1195,48 @@ void load_obj(std::vector<std::string> const& filenames, model& mod)
         }
     }
 
-    // Calculate geometric normals
-    for (auto const& tri : mod.primitives)
+    if (mod.primitive_sink)
     {
-        vec3 n = normalize(cross(tri.e1, tri.e2));
-        mod.geometric_normals.push_back(n);
+        flush_primitives(mod);
+
+        model::tex_coord_list().swap(mod.tex_coords);
+        model::normal_list().swap(mod.shading_normals);
+
+        mod.dedup.bytes_saved = mod.dedup.collapsed_triangles * sizeof(model::triangle_type);
+        return;
     }
 
-    // See that each triangle has (potentially dummy) texture coordinates
-    for (size_t i = mod.tex_coords.size(); i < mod.primitives.size() * 3; ++i)
+    // Tex coords are only kept if some material references a texture.
+    // Dummy tex coords are zero, so padding is the zero fill of a single
+    // resize into the reserved storage
+    bool textured = std::any_of(
+            mod.texture_filenames.begin(),
+            mod.texture_filenames.end(),
+            [](std::string const& name) { return !name.empty(); }
+            );
+
+    if (!textured)
     {
-        mod.tex_coords.emplace_back(0.0f);
+        model::tex_coord_list().swap(mod.tex_coords);
     }
+    else if (mod.tex_coords.size() < mod.primitives.size() * 3)
+    {
+        mod.tex_coords.resize(mod.primitives.size() * 3, vec2(0.0f));
+    }
+
+    if (mod.dedup_groups)
+    {
+        remove_duplicate_groups(mod);
+    }
+
+    // Storage per triangle in the final layout
+    size_t triangle_bytes = sizeof(model::triangle_type)
+                          + (mod.tex_coords.empty() ? 0 : 3 * sizeof(model::tex_coord_type))
+                          + (mod.shading_normals.size() == mod.primitives.size() * 3 ? 3 * sizeof(model::normal_type) : 0);
+
+    mod.dedup.bytes_saved = (mod.dedup.collapsed_triangles + mod.dedup.duplicate_triangles) * triangle_bytes;
 
-	mod.bbox.insert(bounds(mod.primitives));
+    mod.bbox.insert(finish_triangles(mod.primitives));
 }
 
 } // visionaray
@@ -0,0 +1,391 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "distributed.h"
+#include "socket_io.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// render_coordinator
+//
+
+render_coordinator::~render_coordinator()
+{
+    close();
+}
+
+bool render_coordinator::open(
+        std::string const&      address,
+        std::chrono::seconds    worker_timeout,
+        std::chrono::seconds    tile_timeout
+        )
+{
+    close();
+
+    fd_ = listen_socket(address);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    address_ = address;
+    worker_timeout_ = worker_timeout;
+    tile_timeout_ = tile_timeout;
+    closing_ = false;
+
+    accept_thread_ = std::thread([this]()
+    {
+        for (;;)
+        {
+            int conn = accept_socket(fd_);
+
+            if (conn < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (conn < 0)
+            {
+                // close() shut the socket down
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            if (closing_)
+            {
+                ::close(conn);
+                break;
+            }
+
+            join_finished_workers();
+
+            ++num_workers_;
+            worker_fds_.insert(conn);
+            worker_threads_.emplace_back(&render_coordinator::serve_worker, this, conn);
+
+            std::cout << "Worker connected (" << num_workers_ << " total)\n";
+
+            cond_.notify_all();
+        }
+    });
+
+    return true;
+}
+
+void render_coordinator::close()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closing_ = true;
+
+        // Wakes up workers waiting for results
+        for (int fd : worker_fds_)
+        {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    cond_.notify_all();
+
+    // Wakes up accept()
+    shutdown(fd_, SHUT_RDWR);
+
+    if (accept_thread_.joinable())
+    {
+        accept_thread_.join();
+    }
+
+    for (auto& t : worker_threads_)
+    {
+        t.join();
+    }
+
+    ::close(fd_);
+    remove_socket_file(address_);
+
+    fd_ = -1;
+    address_.clear();
+    worker_threads_.clear();
+    finished_workers_.clear();
+    num_workers_ = 0;
+}
+
+bool render_coordinator::is_open() const
+{
+    return fd_ >= 0;
+}
+
+void render_coordinator::wait_for_workers(size_t count)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (num_workers_ < count)
+    {
+        std::cout << "Waiting for " << count - num_workers_ << " worker(s) on " << address_ << "...\n";
+    }
+
+    cond_.wait(lock, [&]() { return num_workers_ >= count; });
+}
+
+bool render_coordinator::render(
+        camera_view const&  view,
+        int                 width,
+        int                 height,
+        unsigned            spp,
+        unsigned            tile_size,
+        unsigned            tile_spp,
+        std::vector<vec4>&  accum
+        )
+{
+    if (spp == 0)
+    {
+        std::cerr << "Distributed rendering needs at least one sample per pixel\n";
+        return false;
+    }
+
+    tile_size = std::max(tile_size, 1U);
+    tile_spp  = tile_spp == 0 ? spp : std::min(tile_spp, spp);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    frame_.frame_id += 1;
+    frame_.width  = static_cast<uint32_t>(width);
+    frame_.height = static_cast<uint32_t>(height);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        frame_.eye[i]    = view.eye[i];
+        frame_.center[i] = view.center[i];
+        frame_.up[i]     = view.up[i];
+    }
+
+    sum_.assign(size_t(width) * height, vec4(0.0f));
+
+    // Sample ranges of a tile are neighbors in the queue, tiles are
+    // finished one after the other
+    for (uint32_t y = 0; y < frame_.height; y += tile_size)
+    {
+        for (uint32_t x = 0; x < frame_.width; x += tile_size)
+        {
+            for (uint32_t first = 0; first < spp; first += tile_spp)
+            {
+                tile_message tile = {};
+                tile.frame_id     = frame_.frame_id;
+                tile.x            = x;
+                tile.y            = y;
+                tile.width        = std::min(tile_size, frame_.width - x);
+                tile.height       = std::min(tile_size, frame_.height - y);
+                tile.sample_first = first;
+                tile.sample_count = std::min(tile_spp, spp - first);
+
+                pending_.push_back(tile);
+            }
+        }
+    }
+
+    remaining_ = pending_.size();
+
+    cond_.notify_all();
+
+    for (;;)
+    {
+        cond_.wait(lock, [&]() { return remaining_ == 0 || num_workers_ == 0 || closing_; });
+
+        if (remaining_ == 0)
+        {
+            break;
+        }
+
+        if (closing_)
+        {
+            return false;
+        }
+
+        auto worker_or_done = [&]() { return remaining_ == 0 || num_workers_ > 0 || closing_; };
+
+        std::cout << "No workers, waiting on " << address_ << "...\n";
+
+        if (worker_timeout_.count() == 0)
+        {
+            cond_.wait(lock, worker_or_done);
+        }
+        else if (!cond_.wait_for(lock, worker_timeout_, worker_or_done))
+        {
+            std::cerr << "No worker connected within " << worker_timeout_.count() << "s, giving up\n";
+            pending_.clear();
+            remaining_ = 0;
+            return false;
+        }
+
+        if (closing_)
+        {
+            return false;
+        }
+    }
+
+    float scale = 1.0f / spp;
+
+    for (auto& v : sum_)
+    {
+        v *= scale;
+    }
+
+    accum.swap(sum_);
+
+    return true;
+}
+
+void render_coordinator::serve_worker(int fd)
+{
+    uint32_t sent_frame = 0;
+    std::vector<vec4> data;
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        cond_.wait(lock, [&]() { return closing_ || !pending_.empty(); });
+
+        if (closing_)
+        {
+            break;
+        }
+
+        tile_message tile = pending_.front();
+        pending_.pop_front();
+
+        frame_message frame = frame_;
+
+        lock.unlock();
+
+        // The frame (if new) and the tile go out in one write
+        message_header frame_header{ FrameMessage, sizeof(frame_message) };
+        message_header tile_header{ TileMessage, sizeof(tile_message) };
+
+        bool new_frame = frame.frame_id != sent_frame;
+        sent_frame = frame.frame_id;
+
+        bool ok = send_all(fd, {
+                { &frame_header, new_frame ? sizeof(frame_header) : 0 },
+                { &frame,        new_frame ? sizeof(frame) : 0 },
+                { &tile_header,  sizeof(tile_header) },
+                { &tile,         sizeof(tile) }
+                });
+
+        if (ok)
+        {
+            message_header header;
+            tile_message result;
+
+            size_t count = size_t(tile.width) * tile.height;
+            data.resize(count);
+
+            // Hung workers and dead hosts are dropped when the result is late
+            auto deadline = tile_timeout_.count() > 0
+                    ? std::chrono::steady_clock::now() + tile_timeout_
+                    : socket_deadline::max();
+
+            errno = 0;
+
+            ok = recv_all(fd, &header, sizeof(header), deadline)
+              && header.type == ResultMessage
+              && header.size == sizeof(tile_message) + count * sizeof(vec4)
+              && recv_all(fd, &result, sizeof(result), deadline)
+              && result.frame_id == tile.frame_id && result.x == tile.x && result.y == tile.y
+              && recv_all(fd, data.data(), count * sizeof(vec4), deadline);
+
+            if (!ok && errno == ETIMEDOUT)
+            {
+                std::cerr << "Worker did not answer within " << tile_timeout_.count() << "s, dropping it\n";
+            }
+        }
+
+        lock.lock();
+
+        if (!ok)
+        {
+            // Someone else renders it
+            pending_.push_front(tile);
+            cond_.notify_all();
+
+            if (!closing_)
+            {
+                std::cerr << "Worker lost, re-dispatching tile (" << tile.x << ", " << tile.y << ")\n";
+            }
+
+            break;
+        }
+
+        merge(tile, data);
+
+        if (--remaining_ == 0)
+        {
+            cond_.notify_all();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    --num_workers_;
+    worker_fds_.erase(fd);
+    ::close(fd);
+
+    // Joined by the accept thread or close()
+    finished_workers_.push_back(std::this_thread::get_id());
+
+    cond_.notify_all();
+}
+
+// With mutex_ locked. Finished workers only return after unlocking, so
+// joining them does not block for long
+void render_coordinator::join_finished_workers()
+{
+    for (auto id : finished_workers_)
+    {
+        auto it = std::find_if(worker_threads_.begin(), worker_threads_.end(), [id](std::thread const& t)
+        {
+            return t.get_id() == id;
+        });
+
+        if (it != worker_threads_.end())
+        {
+            it->join();
+            worker_threads_.erase(it);
+        }
+    }
+
+    finished_workers_.clear();
+}
+
+void render_coordinator::merge(tile_message const& tile, std::vector<vec4> const& data)
+{
+    float weight = static_cast<float>(tile.sample_count);
+
+    for (uint32_t y = 0; y < tile.height; ++y)
+    {
+        vec4* dst = sum_.data() + size_t(tile.y + y) * frame_.width + tile.x;
+        vec4 const* src = data.data() + size_t(y) * tile.width;
+
+        for (uint32_t x = 0; x < tile.width; ++x)
+        {
+            dst[x] += src[x] * weight;
+        }
+    }
+}
+
+} // namespace visionaray
@@ -0,0 +1,157 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <visionaray/math/math.h>
+
+#include "camera_path.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Coordinator/worker protocol
+//
+// Workers connect to the coordinator and then only answer: a frame message
+// sets resolution and camera, each tile message is answered with a result
+// message holding the tile's RGBA32F mean over its sample range, rows as in
+// the accumulation buffer. Messages are a message_header followed by size
+// bytes, in native byte order (all hosts must share the architecture)
+//
+
+enum message_type : uint32_t
+{
+    FrameMessage  = 1,
+    TileMessage   = 2,
+    ResultMessage = 3
+};
+
+struct message_header
+{
+    uint32_t type;
+    uint32_t size;
+};
+
+struct frame_message
+{
+    uint32_t frame_id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    float    eye[3];
+    float    center[3];
+    float    up[3];
+};
+
+// Also the head of a result message, followed by width * height * 4 floats
+struct tile_message
+{
+    uint32_t frame_id;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    uint32_t sample_first;
+    uint32_t sample_count;
+    uint32_t reserved;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Coordinator
+//
+// Splits frames into tiles (and optionally sample ranges), hands them to
+// whichever worker is idle and merges the results. Assignments of workers
+// that disconnect are handed to the others again. Workers may join at any
+// time; if none is left, a frame waits worker_timeout for one to connect
+//
+
+class render_coordinator
+{
+public:
+
+    render_coordinator() = default;
+   ~render_coordinator();
+
+    render_coordinator(render_coordinator const&) = delete;
+    render_coordinator& operator=(render_coordinator const&) = delete;
+
+    // worker_timeout == 0 waits for workers forever, workers that do not
+    // deliver a tile within tile_timeout (0 = no limit) are dropped and the
+    // tile is handed to another one
+    bool open(
+            std::string const&      address,
+            std::chrono::seconds    worker_timeout,
+            std::chrono::seconds    tile_timeout
+            );
+    void close();
+
+    bool is_open() const;
+
+    // Blocks until count workers are connected
+    void wait_for_workers(size_t count);
+
+    // Mean of spp samples per pixel, in the accumulation buffer layout.
+    // tile_spp == 0 assigns all samples of a tile at once. Returns false if
+    // spp is 0 or no worker connects within the timeout
+    bool render(
+            camera_view const&  view,
+            int                 width,
+            int                 height,
+            unsigned            spp,
+            unsigned            tile_size,
+            unsigned            tile_spp,
+            std::vector<vec4>&  accum
+            );
+
+private:
+
+    std::string                 address_;
+    int                         fd_         = -1;
+    std::thread                 accept_thread_;
+    std::chrono::seconds        worker_timeout_ { 0 };
+    std::chrono::seconds        tile_timeout_ { 0 };
+
+    std::mutex                  mutex_;
+    std::condition_variable     cond_;
+    bool                        closing_    = false;
+    size_t                      num_workers_ = 0;
+    std::set<int>               worker_fds_;
+    std::vector<std::thread>    worker_threads_;
+    std::vector<std::thread::id> finished_workers_;
+
+    // Current frame
+    frame_message               frame_      = {};
+    std::deque<tile_message>    pending_;
+    size_t                      remaining_  = 0;
+    std::vector<vec4>           sum_;
+
+    void serve_worker(int fd);
+    void join_finished_workers();
+    void merge(tile_message const& tile, std::vector<vec4> const& data);
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Worker, renders assignments with the renderer's scene until the
+// coordinator disconnects. Returns false if it cannot connect
+//
+
+template <typename Renderer>
+bool run_worker(Renderer& rend, std::string const& address);
+
+} // namespace visionaray
+
+#include "distributed.inl"
@@ -0,0 +1,123 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "socket_io.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Worker
+//
+
+template <typename Renderer>
+bool run_worker(Renderer& rend, std::string const& address)
+{
+    int fd = connect_socket(address);
+
+    if (fd < 0)
+    {
+        std::cerr << "Cannot connect to coordinator: " << address << '\n';
+        return false;
+    }
+
+    std::cout << "Connected to " << address << '\n';
+
+    frame_message frame = {};
+    std::vector<vec4> tile_data;
+    message_header header;
+
+    while (recv_all(fd, &header, sizeof(header)))
+    {
+        if (header.type == FrameMessage && header.size == sizeof(frame_message))
+        {
+            if (!recv_all(fd, &frame, sizeof(frame)))
+            {
+                break;
+            }
+
+            if (frame.width != rend.width || frame.height != rend.height)
+            {
+                rend.width  = frame.width;
+                rend.height = frame.height;
+                rend.resize(static_cast<int>(frame.width), static_cast<int>(frame.height));
+            }
+
+            rend.cam.look_at(
+                    vec3(frame.eye[0], frame.eye[1], frame.eye[2]),
+                    vec3(frame.center[0], frame.center[1], frame.center[2]),
+                    vec3(frame.up[0], frame.up[1], frame.up[2])
+                    );
+        }
+        else if (header.type == TileMessage && header.size == sizeof(tile_message))
+        {
+            tile_message tile;
+
+            if (!recv_all(fd, &tile, sizeof(tile)))
+            {
+                break;
+            }
+
+            if (tile.frame_id != frame.frame_id
+             || tile.width == 0 || tile.x + tile.width > frame.width
+             || tile.height == 0 || tile.y + tile.height > frame.height)
+            {
+                std::cerr << "Invalid tile assignment\n";
+                break;
+            }
+
+            rend.scissor_box = recti(tile.x, tile.y, tile.width, tile.height);
+            rend.sample_first = tile.sample_first;
+
+            // The first sample overwrites the tile, no need to clear
+            rend.frame_num = 0;
+
+            for (uint32_t sample = 0; sample < tile.sample_count; ++sample)
+            {
+                rend.render();
+            }
+
+            tile_data.resize(size_t(tile.width) * tile.height);
+
+            vec4 const* accum = rend.accum_buffer();
+
+            for (uint32_t y = 0; y < tile.height; ++y)
+            {
+                vec4 const* row = accum + size_t(tile.y + y) * frame.width + tile.x;
+                std::copy(row, row + tile.width, tile_data.data() + size_t(y) * tile.width);
+            }
+
+            message_header result{ ResultMessage, static_cast<uint32_t>(sizeof(tile) + tile_data.size() * sizeof(vec4)) };
+
+            if (!send_all(fd, {
+                    { &result, sizeof(result) },
+                    { &tile, sizeof(tile) },
+                    { tile_data.data(), tile_data.size() * sizeof(vec4) }
+                    }))
+            {
+                break;
+            }
+        }
+        else
+        {
+            std::cerr << "Unexpected message from coordinator\n";
+            break;
+        }
+    }
+
+    close(fd);
+
+    rend.scissor_box = recti(0, 0, 0, 0);
+
+    std::cout << "Coordinator disconnected\n";
+
+    return true;
+}
+
+} // namespace visionaray
@@ -0,0 +1,160 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "frame_stream.h"
+#include "parallel_for.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// RGB to YCbCr, BT.601 limited range
+//
+
+static void rgb_to_ycbcr(uint8_t* y, uint8_t* cb, uint8_t* cr, uint8_t const* rgb, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        int r = rgb[i * 3];
+        int g = rgb[i * 3 + 1];
+        int b = rgb[i * 3 + 2];
+
+        y[i]  = static_cast<uint8_t>((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+        cb[i] = static_cast<uint8_t>(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+        cr[i] = static_cast<uint8_t>(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// frame_stream
+//
+
+frame_stream::~frame_stream()
+{
+    close();
+}
+
+bool frame_stream::open(std::string const& filename, stream_format format, int width, int height, unsigned fps)
+{
+    close();
+
+    if (filename == "-")
+    {
+        // Keep stdout for the stream, send everything else to stderr
+        std::cout.flush();
+        std::fflush(stdout);
+
+        fd_ = dup(STDOUT_FILENO);
+
+        if (fd_ >= 0)
+        {
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        }
+    }
+    else
+    {
+        // Also works for FIFOs, open blocks until a reader is connected
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    format_ = format;
+    width_  = width;
+    height_ = height;
+
+    if (format_ == Y4MStream)
+    {
+        planes_.resize(size_t(width_) * height_ * 3);
+
+        std::string header = "YUV4MPEG2 W" + std::to_string(width_)
+                           + " H" + std::to_string(height_)
+                           + " F" + std::to_string(fps) + ":1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n";
+
+        if (!write_all(header.data(), header.size()))
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void frame_stream::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+
+    fd_ = -1;
+    planes_.clear();
+}
+
+bool frame_stream::is_open() const
+{
+    return fd_ >= 0;
+}
+
+bool frame_stream::write_frame(uint8_t const* rgb)
+{
+    size_t count = size_t(width_) * height_;
+
+    if (format_ == RawStream)
+    {
+        return write_all(rgb, count * 3);
+    }
+
+    uint8_t* y  = planes_.data();
+    uint8_t* cb = y + count;
+    uint8_t* cr = cb + count;
+
+    parallel_for(0, count, 1 << 16, [&](size_t first, size_t last)
+    {
+        rgb_to_ycbcr(y + first, cb + first, cr + first, rgb + first * 3, last - first);
+    });
+
+    static char const frame_header[] = "FRAME\n";
+
+    return write_all(frame_header, sizeof(frame_header) - 1) && write_all(planes_.data(), planes_.size());
+}
+
+bool frame_stream::write_all(void const* data, size_t size)
+{
+    auto ptr = static_cast<char const*>(data);
+
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd_, ptr, size);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        ptr  += n;
+        size -= static_cast<size_t>(n);
+    }
+
+    return true;
+}
+
+} // namespace visionaray
@@ -0,0 +1,67 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Uncompressed video stream formats
+//
+//  raw: RGB24 frames back to back, e.g.
+//       ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH -framerate 30 -i - out.mp4
+//  y4m: YUV4MPEG2, 4:4:4 BT.601 limited range, e.g. ffmpeg -i - out.mp4
+//
+
+enum stream_format
+{
+    NoStream = 0,
+    RawStream,
+    Y4MStream
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Sequential frame writer for stdout, a FIFO or a file
+//
+
+class frame_stream
+{
+public:
+
+    frame_stream() = default;
+   ~frame_stream();
+
+    frame_stream(frame_stream const&) = delete;
+    frame_stream& operator=(frame_stream const&) = delete;
+
+    // filename "-" writes to stdout. stdout is then redirected to stderr, so
+    // log output does not end up in the stream
+    bool open(std::string const& filename, stream_format format, int width, int height, unsigned fps);
+    void close();
+
+    bool is_open() const;
+
+    // width * height RGB8 pixels, top row first
+    bool write_frame(uint8_t const* rgb);
+
+private:
+
+    int                     fd_         = -1;
+    stream_format           format_     = NoStream;
+    int                     width_      = 0;
+    int                     height_     = 0;
+
+    // Y, Cb and Cr planes
+    std::vector<uint8_t>    planes_;
+
+    bool write_all(void const* data, size_t size);
+
+};
+
+} // namespace visionaray
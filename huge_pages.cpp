@@ -0,0 +1,112 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cstdint>
+
+#include <sys/mman.h>
+
+#include "huge_pages.h"
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+
+namespace visionaray
+{
+
+static constexpr size_t page_2m = size_t(1) << 21;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static char* align_up(char* ptr, size_t alignment)
+{
+    auto p = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<char*>((p + alignment - 1) / alignment * alignment);
+}
+
+static char* align_down(char* ptr, size_t alignment)
+{
+    auto p = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<char*>(p / alignment * alignment);
+}
+
+static void use_transparent(char* first, size_t size, bool populated, huge_page_stats& stats)
+{
+    if (madvise(first, size, MADV_HUGEPAGE) != 0)
+    {
+        return;
+    }
+
+    if (populated && madvise(first, size, MADV_COLLAPSE) == 0)
+    {
+        stats.collapsed += size;
+    }
+    else
+    {
+        stats.advised += size;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+huge_page_stats& huge_page_stats::operator+=(huge_page_stats const& rhs)
+{
+    bytes       += rhs.bytes;
+    collapsed   += rhs.collapsed;
+    advised     += rhs.advised;
+    return *this;
+}
+
+huge_page_stats use_huge_pages(void const* ptr, size_t size, huge_page_mode mode, bool populated)
+{
+    huge_page_stats stats;
+    stats.bytes = size;
+
+    // Contents stay the same, only the backing pages change
+    char* begin = const_cast<char*>(static_cast<char const*>(ptr));
+    char* first = align_up(begin, page_2m);
+    char* last  = align_down(begin + size, page_2m);
+
+    if (mode == NoHugePages || ptr == nullptr || last <= first)
+    {
+        return stats;
+    }
+
+    use_transparent(first, last - first, populated, stats);
+
+    return stats;
+}
+
+void print_huge_page_stats(std::ostream& out, char const* name, huge_page_stats const& stats)
+{
+    auto mb = [](size_t bytes) { return bytes / (1024 * 1024); };
+
+    out << name << ": " << mb(stats.bytes) << " MB";
+
+    if (stats.collapsed > 0)
+    {
+        out << ", " << mb(stats.collapsed) << " MB on transparent huge pages";
+    }
+
+    if (stats.advised > 0)
+    {
+        out << ", " << mb(stats.advised) << " MB advised for transparent huge pages";
+    }
+
+    size_t huge = stats.collapsed + stats.advised;
+
+    if (huge < stats.bytes)
+    {
+        out << ", " << mb(stats.bytes - huge) << " MB on 4 KB pages";
+    }
+
+    out << '\n';
+}
+
+} // namespace visionaray
@@ -0,0 +1,46 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Huge pages for large, read-mostly arrays
+//
+// Arrays are allocated by visionaray's containers (i.e. malloc), so only
+// transparent huge pages can be applied, to the 2 MB aligned interior of
+// existing allocations: madvise(MADV_HUGEPAGE), then MADV_COLLAPSE (Linux
+// 6.1+) to back the already populated pages with huge pages right away
+// instead of waiting for khugepaged. Collapsing allocates new pages in the
+// calling thread's context, so per-node copies should be advised from a
+// thread on their node. Partial pages at either end keep their 4 KB pages
+//
+
+enum huge_page_mode
+{
+    NoHugePages = 0,
+    TransparentHugePages
+};
+
+struct huge_page_stats
+{
+    size_t bytes            = 0;    // array sizes
+    size_t collapsed        = 0;    // transparent huge pages, collapsed
+    size_t advised          = 0;    // MADV_HUGEPAGE only (khugepaged decides)
+
+    huge_page_stats& operator+=(huge_page_stats const& rhs);
+};
+
+// populated == false: the pages have not been touched yet (e.g. after
+// release_pages()) and are only advised, the first touch then allocates the
+// huge pages on the toucher's node
+huge_page_stats use_huge_pages(void const* ptr, size_t size, huge_page_mode mode, bool populated = true);
+
+// "name: 512 MB, 510 MB on 2 MB pages, ..."
+void print_huge_page_stats(std::ostream& out, char const* name, huge_page_stats const& stats);
+
+} // namespace visionaray
@@ -0,0 +1,458 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <visionaray/math/math.h>
+#include <visionaray/get_surface.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/result_record.h>
+#include <visionaray/spectrum.h>
+#include <visionaray/traverse.h>
+
+#include "mip_texture.h"
+#include "occlusion.h"
+#include "render_stats.h"
+#include "shading.h"
+#include "simd_lanes.h"
+#include "thread_affinity.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Path tracing kernel with next event estimation
+//
+// Params are kernel params over BVH refs (see make_kernel_params()). Light
+// visibility is resolved with the any-hit occlusion query instead of the
+// closest-hit traversal used for camera and bounce rays. Paths are
+// terminated with Russian roulette from bounce rr_depth on; once no more
+// than compact_threshold of the lanes of a packet are alive, the remaining
+// lanes are finished as single rays. If stats is set, ray counts and
+// traversal times are accumulated there. Shading bins the lanes of a packet
+// by material kind and runs one SIMD pass per kind (see pack_materials()),
+// only kinds in Kinds are compiled in. Diffuse textures are looked up with
+// a level of detail from ray cones (see texture_set), the lookup is only
+// compiled in if Textured is set. Geometric normals are derived from the
+// triangle edges at hit time, no per-triangle normals are stored
+//
+
+template <typename Params, unsigned Kinds = AllKinds, bool Textured = true>
+struct path_kernel
+{
+    using clock = std::chrono::steady_clock;
+    using prim_iterator = std::decay_t<decltype(std::declval<Params>().prims.begin)>;
+
+    Params                  params;
+    material_bins const*    materials           = nullptr;
+    texture_set const*      textures            = nullptr;
+    render_stats*           stats               = nullptr;
+    unsigned                rr_depth            = 3;
+    float                   compact_threshold   = 0.25f;
+
+    // Spread angle of the ray cone of a camera ray (radians per unit distance)
+    float                   cone_spread         = 0.0f;
+
+    // Global index of the sample being rendered, selects the random stream
+    size_t                  sample_index        = 0;
+
+    // If set, per NUMA node replacements for params.prims.begin (copies of
+    // the BVHs in node-local memory)
+    prim_iterator const*    node_prims          = nullptr;
+    unsigned                num_nodes           = 0;
+
+    template <typename R, typename Generator>
+    result_record<typename R::scalar_type> operator()(R ray, Generator& gen) const
+    {
+        using S = typename R::scalar_type;
+        using M = simd::mask_type_t<S>;
+        using C = spectrum<S>;
+
+        if (node_prims != nullptr)
+        {
+            path_kernel local = *this;
+            local.node_prims = nullptr;
+            local.params.prims.begin = node_prims[current_numa_node() % num_nodes];
+            local.params.prims.end = local.params.prims.begin + (params.prims.end - params.prims.begin);
+            return local(ray, gen);
+        }
+
+        counters cnt;
+
+        C intensity(0.0);
+        C throughput(1.0);
+
+        result_record<S> result;
+
+        auto hit_rec = closest_hit_counted(ray, cnt);
+
+        result.hit = hit_rec.hit;
+        result.isect_pos = ray.ori + ray.dir * hit_rec.t;
+
+        M active = hit_rec.hit;
+
+        if (any(active))
+        {
+            // Paths of different sample indices use independent streams, also
+            // across processes that render disjoint sample ranges
+            Generator path_gen(stream_seed(draw_seeds<S>(gen)[0]));
+
+            trace(ray, hit_rec, active, throughput, intensity, S(0.0), 0, path_gen, cnt);
+        }
+
+        result.color = select(result.hit, to_rgba(intensity), vector<4, S>(params.bg_color));
+
+        if (stats)
+        {
+            flush(cnt);
+        }
+
+        return result;
+    }
+
+private:
+
+    // Work done for one packet, flushed to stats once per kernel call
+    struct counters
+    {
+        occlusion_counters  shadow;
+        uint64_t            path_queries    = 0;
+        uint64_t            compacted_lanes = 0;
+        clock::duration     path_time       = clock::duration(0);
+        clock::duration     shadow_time     = clock::duration(0);
+    };
+
+    // Mix the sample index into a seed (splitmix64 finalizer)
+    unsigned stream_seed(uint32_t seed) const
+    {
+        uint64_t h = seed ^ (static_cast<uint64_t>(sample_index) * 0x9E3779B97F4A7C15ull);
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        return static_cast<unsigned>(h);
+    }
+
+    // 32 random bits per lane, the upper 16 bits of two draws each. A single
+    // float draw only holds about 24 bits, i.e. would allow 2^24 seeds
+    template <typename S, typename Generator>
+    static std::array<uint32_t, simd::num_elements<S>::value> draw_seeds(Generator& gen)
+    {
+        lane_array<S> hi;
+        lane_array<S> lo;
+        store_lanes<S>(hi, gen.next());
+        store_lanes<S>(lo, gen.next());
+
+        std::array<uint32_t, simd::num_elements<S>::value> result;
+
+        for (size_t l = 0; l < result.size(); ++l)
+        {
+            result[l] = (static_cast<uint32_t>(hi[l] * 65536.0f) << 16) | static_cast<uint32_t>(lo[l] * 65536.0f);
+        }
+
+        return result;
+    }
+
+    template <typename R>
+    auto closest_hit_counted(R const& ray, counters& cnt) const
+        -> decltype(closest_hit(ray, params.prims.begin, params.prims.end))
+    {
+        auto t0 = stats ? clock::now() : clock::time_point();
+
+        auto hit_rec = closest_hit(ray, params.prims.begin, params.prims.end);
+
+        if (stats)
+        {
+            cnt.path_time += clock::now() - t0;
+            ++cnt.path_queries;
+        }
+
+        return hit_rec;
+    }
+
+    // Shade the hits in hit_rec and continue the paths of the active lanes
+    template <typename R, typename HR, typename Generator>
+    void trace(
+            R                                           ray,
+            HR                                          hit_rec,
+            simd::mask_type_t<typename R::scalar_type>  active,
+            spectrum<typename R::scalar_type>&          throughput,
+            spectrum<typename R::scalar_type>&          intensity,
+            typename R::scalar_type                     cone_width,
+            unsigned                                    bounce,
+            Generator&                                  gen,
+            counters&                                   cnt
+            ) const
+    {
+        using S = typename R::scalar_type;
+        using I = simd::int_type_t<S>;
+        using M = simd::mask_type_t<S>;
+        using V = vector<3, S>;
+        using C = spectrum<S>;
+
+        C ambient = from_rgba(vector<4, S>(params.ambient_color));
+
+        for (;;)
+        {
+            hit_rec.isect_pos = ray.ori + ray.dir * hit_rec.t;
+
+            // Ray cone width at the hit point, curvature is ignored
+            cone_width += S(cone_spread) * hit_rec.t;
+
+            // Normals from the surface, shading with the materials binned by kind
+            auto surf = get_surface(hit_rec, params);
+            auto mats = pack_materials<S, Kinds>(*materials, hit_rec.geom_id, active);
+
+            shade_record<S> sr;
+            sr.isect_pos = hit_rec.isect_pos;
+            sr.view_dir = -ray.dir;
+            sr.geometric_normal = surf.geometric_normal;
+            sr.normal = surf.shading_normal;
+            sr.tex_color = V(1.0);
+
+            V view_dir = sr.view_dir;
+            V ng = sr.geometric_normal;
+
+            if constexpr (Textured)
+            {
+                if (textures && !textures->empty())
+                {
+                    S cos_theta = max(abs(dot(ng, ray.dir)), S(1.0e-3f));
+                    sr.tex_color = texture_color<S>(hit_rec, cone_width / cos_theta, active);
+                }
+            }
+
+            intensity += select(active, throughput * mats.emission(sr), C(0.0));
+
+
+            // Direct light
+
+            for (auto it = params.lights.begin; it != params.lights.end; ++it)
+            {
+                V L = V(it->position()) - hit_rec.isect_pos;
+                S dist = length(L);
+                L /= dist;
+
+                // Only query lights on the side of the surface we look at
+                M lit = active & (dot(ng, L) * dot(ng, view_dir) > S(0.0));
+
+                if (!any(lit))
+                {
+                    continue;
+                }
+
+                R shadow_ray;
+                shadow_ray.ori = hit_rec.isect_pos + L * S(params.epsilon);
+                shadow_ray.dir = L;
+
+                auto t0 = stats ? clock::now() : clock::time_point();
+
+                S max_t = dist - S(2.0f * params.epsilon);
+                for (auto b = params.prims.begin; b != params.prims.end && any(lit); ++b)
+                {
+                    lit &= !occluded(shadow_ray, *b, max_t, cnt.shadow, lit);
+                }
+
+                if (stats)
+                {
+                    cnt.shadow_time += clock::now() - t0;
+                }
+
+                sr.light_dir = L;
+                sr.light_intensity = it->intensity(hit_rec.isect_pos);
+
+                auto clr = mats.shade(sr);
+                intensity += select(lit, throughput * clr, C(0.0));
+            }
+
+            if (++bounce >= params.num_bounces)
+            {
+                return;
+            }
+
+
+            // Sample the continuation of the path
+
+            V refl_dir;
+            S pdf(0.0);
+            I inter = 0;
+
+            auto f = mats.sample(sr, refl_dir, pdf, inter, gen);
+
+            active &= pdf > S(0.0);
+
+            S weight = select(active, abs(dot(sr.normal, refl_dir)) / pdf, S(0.0));
+            throughput = select(active, throughput * f * weight, C(0.0));
+
+
+            // Russian roulette, survivors are reweighted by the survival probability
+
+            if (bounce >= rr_depth)
+            {
+                S q = min(max_element(to_rgb(throughput)), S(0.95f));
+                active &= gen.next() < q;
+                throughput = select(active, throughput / q, C(0.0));
+            }
+
+            if (!any(active))
+            {
+                return;
+            }
+
+            ray.ori = hit_rec.isect_pos + refl_dir * S(params.epsilon);
+            ray.dir = refl_dir;
+
+
+            // Lane compaction
+
+            if constexpr (simd::num_elements<S>::value > 1)
+            {
+                int num_active = count_lanes<S>(active);
+
+                if (num_active <= compact_threshold * simd::num_elements<S>::value)
+                {
+                    finish_lanes(ray, active, throughput, intensity, cone_width, bounce, gen, cnt);
+                    cnt.compacted_lanes += num_active;
+                    return;
+                }
+            }
+
+            hit_rec = closest_hit_counted(ray, cnt);
+
+            // Bounce rays that leave the scene pick up the ambient color
+            M exited = active & !hit_rec.hit;
+            intensity += select(exited, throughput * ambient, C(0.0));
+
+            active &= hit_rec.hit;
+
+            if (!any(active))
+            {
+                return;
+            }
+        }
+    }
+
+    // Continue the active lanes of a packet as single rays
+    template <typename R, typename Generator>
+    void finish_lanes(
+            R const&                                    ray,
+            simd::mask_type_t<typename R::scalar_type>  active,
+            spectrum<typename R::scalar_type>&          throughput,
+            spectrum<typename R::scalar_type>&          intensity,
+            typename R::scalar_type const&              cone_width,
+            unsigned                                    bounce,
+            Generator&                                  gen,
+            counters&                                   cnt
+            ) const
+    {
+        using S = typename R::scalar_type;
+        using V = vector<3, S>;
+
+        lane_array<S> ox, oy, oz, dx, dy, dz;
+        lane_array<S> tr, tg, tb;
+        lane_array<S> ir, ig, ib;
+        lane_array<S> cones;
+
+        V t = to_rgb(throughput);
+        V i = to_rgb(intensity);
+
+        store_lanes<S>(ox, ray.ori.x); store_lanes<S>(oy, ray.ori.y); store_lanes<S>(oz, ray.ori.z);
+        store_lanes<S>(dx, ray.dir.x); store_lanes<S>(dy, ray.dir.y); store_lanes<S>(dz, ray.dir.z);
+        store_lanes<S>(tr, t.x); store_lanes<S>(tg, t.y); store_lanes<S>(tb, t.z);
+        store_lanes<S>(ir, i.x); store_lanes<S>(ig, i.y); store_lanes<S>(ib, i.z);
+        store_lanes<S>(cones, cone_width);
+        auto seeds = draw_seeds<S>(gen);
+
+        auto lanes = mask_lanes<S>(active);
+
+        for (size_t l = 0; l < lanes.size(); ++l)
+        {
+            if (lanes[l] == 0.0f)
+            {
+                continue;
+            }
+
+            basic_ray<float> r(vec3(ox[l], oy[l], oz[l]), vec3(dx[l], dy[l], dz[l]));
+            random_generator<float> g(seeds[l]);
+
+            spectrum<float> lane_throughput = from_rgb(vec3(tr[l], tg[l], tb[l]));
+            spectrum<float> lane_intensity(0.0f);
+
+            auto hit_rec = closest_hit_counted(r, cnt);
+
+            if (hit_rec.hit)
+            {
+                trace(r, hit_rec, true, lane_throughput, lane_intensity, cones[l], bounce, g, cnt);
+            }
+            else
+            {
+                lane_intensity += lane_throughput * from_rgba(params.ambient_color);
+            }
+
+            vec3 rgb = to_rgb(lane_intensity);
+            ir[l] += rgb.x;
+            ig[l] += rgb.y;
+            ib[l] += rgb.z;
+        }
+
+        intensity = from_rgb(V(load_lanes<S>(ir), load_lanes<S>(ig), load_lanes<S>(ib)));
+    }
+
+    // Texture color of the active lanes, footprint is the ray cone width on the surface
+    template <typename S, typename HR>
+    vector<3, S> texture_color(HR const& hit_rec, S const& footprint, simd::mask_type_t<S> const& active) const
+    {
+        using I = simd::int_type_t<S>;
+
+        lane_array<I> geom_ids, prim_ids;
+        lane_array<S> us, vs, fps;
+        lane_array<S> r, g, b;
+
+        store_lanes<I>(geom_ids, I(hit_rec.geom_id));
+        store_lanes<I>(prim_ids, I(hit_rec.prim_id));
+        store_lanes<S>(us, hit_rec.u);
+        store_lanes<S>(vs, hit_rec.v);
+        store_lanes<S>(fps, footprint);
+
+        auto lanes = mask_lanes<S>(active);
+
+        for (size_t l = 0; l < lanes.size(); ++l)
+        {
+            vec4 c(1.0f);
+
+            if (lanes[l] != 0.0f)
+            {
+                c = textures->sample(geom_ids[l], prim_ids[l], us[l], vs[l], fps[l]);
+            }
+
+            r[l] = c.x;
+            g[l] = c.y;
+            b[l] = c.z;
+        }
+
+        return vector<3, S>(load_lanes<S>(r), load_lanes<S>(g), load_lanes<S>(b));
+    }
+
+    void flush(counters const& cnt) const
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+
+        stats->path_queries.fetch_add(cnt.path_queries, std::memory_order_relaxed);
+        stats->path_ns.fetch_add(duration_cast<nanoseconds>(cnt.path_time).count(), std::memory_order_relaxed);
+        stats->compacted_lanes.fetch_add(cnt.compacted_lanes, std::memory_order_relaxed);
+        stats->shadow_queries.fetch_add(cnt.shadow.queries, std::memory_order_relaxed);
+        stats->shadow_nodes.fetch_add(cnt.shadow.nodes, std::memory_order_relaxed);
+        stats->shadow_prims.fetch_add(cnt.shadow.prims, std::memory_order_relaxed);
+        stats->shadow_ns.fetch_add(duration_cast<nanoseconds>(cnt.shadow_time).count(), std::memory_order_relaxed);
+    }
+};
+
+} // namespace visionaray
@@ -1,10 +1,12 @@
 // This file is distributed under the MIT license.
 // See the LICENSE file for details.
 
+#include <chrono>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <visionaray/bvh.h>
 #include <visionaray/math/math.h>
@@ -13,6 +15,12 @@
 
 #include <common/timer.h>
 
+#include "accum_file.h"
+#include "bvh_stats.h"
+#include "camera_path.h"
+#include "distributed.h"
+#include "frame_stream.h"
+#include "render_server.h"
 #include "renderer.h"
 
 using namespace visionaray;
@@ -44,23 +52,180 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    if (!rend.mod.load(rend.filename))
+    if (!rend.shm_name.empty() && !rend.shm_rt.is_open())
     {
-        std::cerr << "Failed loading obj model\n";
         return EXIT_FAILURE;
     }
 
-    std::cout << "Creating BVH...\n";
+    if (!rend.serve_socket.empty())
+    {
+        // Scenes are loaded on request, the positional file name first
+        render_server<renderer<host_ray_type>> server(rend);
+        return server.run(rend.serve_socket, rend.serve_scenes) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!rend.worker_address.empty())
+    {
+        if (!rend.load_scene(rend.filename))
+        {
+            std::cerr << "Failed loading obj model\n";
+            return EXIT_FAILURE;
+        }
+
+        return run_worker(rend, rend.worker_address) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // The coordinator only needs the scene bounds for the camera
+    bool coordinating = !rend.coordinator_address.empty();
+
+    // Open the stream first, so that log output is redirected to stderr
+    frame_stream stream;
+
+    if (rend.stream != NoStream
+     && !stream.open(rend.stream_filename, rend.stream, rend.width, rend.height, rend.fps))
+    {
+        std::cerr << "Cannot open stream output: " << rend.stream_filename << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // An existing out-of-core cache replaces loading and BVH construction,
+    // a missing one is written while loading
+    bool ooc_cached = !coordinating && !rend.ooc_filename.empty() && std::ifstream(rend.ooc_filename).good();
+    bool ooc_write = !coordinating && !rend.ooc_filename.empty() && !ooc_cached;
+
+    // With a texture cache, the loader only records texture file names
+    rend.mod.load_textures = rend.texture_cache_filename.empty() && !coordinating;
+    rend.mod.weld_epsilon = rend.weld_epsilon;
+    rend.mod.dedup_groups = rend.dedup_groups;
+
+    // Groups are not kept while the cache is written, so they cannot be compared
+    if (ooc_write && rend.dedup_groups)
+    {
+        std::cerr << "-dedup cannot be used while writing an out-of-core cache (-ooc)\n";
+        return EXIT_FAILURE;
+    }
+
+    if (ooc_write && !rend.write_out_of_core())
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!ooc_cached)
+    {
+        if (!ooc_write && !rend.mod.load(rend.filename))
+        {
+            std::cerr << "Failed loading obj model\n";
+            return EXIT_FAILURE;
+        }
+
+        auto const& d = rend.mod.dedup;
+
+        if (rend.weld_epsilon > 0.0f)
+        {
+            std::cout << "Welded " << d.welded_vertices << " vertices (" << d.collapsed_triangles
+                      << " triangles collapsed)\n";
+        }
+
+        if (rend.dedup_groups)
+        {
+            std::cout << "Removed " << d.duplicate_groups << " duplicate groups ("
+                      << d.duplicate_triangles << " triangles)\n";
+        }
+
+        if (rend.weld_epsilon > 0.0f || rend.dedup_groups)
+        {
+            std::cout << "Deduplication saved " << d.bytes_saved / 1024 << " KB\n";
+        }
+    }
+
+    if (!ooc_cached && !ooc_write && !coordinating)
+    {
+        std::cout << "Creating BVH...\n";
+
+        rend.build_bvh();
 
-    binned_sah_builder builder;
-    builder.enable_spatial_splits(rend.build_strategy == renderer<host_ray_type>::Split);
+        if (rend.show_bvh_stats || !rend.bvh_stats_filename.empty())
+        {
+            auto stats = compute_bvh_stats(rend.host_bvh, rend.mod.primitives.size());
+
+            if (rend.show_bvh_stats)
+            {
+                print_bvh_stats(std::cout, stats);
+            }
+
+            if (!rend.bvh_stats_filename.empty())
+            {
+                std::ofstream json(rend.bvh_stats_filename);
+                if (json.good())
+                {
+                    write_bvh_stats_json(json, stats);
+                }
+                else
+                {
+                    std::cerr << "Warning: cannot write BVH statistics to file: " << rend.bvh_stats_filename << '\n';
+                }
+            }
+        }
+    }
+
+    if (!rend.ooc_filename.empty() && !coordinating && !rend.open_out_of_core())
+    {
+        return EXIT_FAILURE;
+    }
 
-    rend.host_bvh = builder.build(
-            index_bvh<model::triangle_type>{},
-            rend.mod.primitives.data(),
-            rend.mod.primitives.size()
-            );
     rend.materials = make_materials(plastic<float>{}, rend.mod.materials);
+    rend.binned_materials = make_material_bins(make_scene_materials(rend.mod.materials));
+
+    if (!rend.texture_cache_filename.empty() && !coordinating)
+    {
+        if (!std::ifstream(rend.texture_cache_filename).good())
+        {
+            std::vector<std::string> image_files;
+            for (auto const& name : rend.mod.texture_filenames)
+            {
+                if (!name.empty())
+                {
+                    image_files.push_back(name);
+                }
+            }
+
+            std::cout << "Writing texture cache " << rend.texture_cache_filename << "...\n";
+
+            if (!texture_cache::write(rend.texture_cache_filename, image_files))
+            {
+                std::cerr << "Cannot write texture cache file: " << rend.texture_cache_filename << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (!rend.tex_cache.open(rend.texture_cache_filename, rend.texture_budget * 1024 * 1024))
+        {
+            std::cerr << "Cannot open texture cache file: " << rend.texture_cache_filename << '\n';
+            return EXIT_FAILURE;
+        }
+
+        rend.textures = make_texture_set(rend.mod, rend.tex_cache);
+
+        auto c = rend.tex_cache.get_counters();
+        std::cout << "Textures: " << c.num_textures << ", " << c.total_bytes / (1024 * 1024) << " MB in cache\n";
+    }
+    else
+    {
+        // Mip pyramids replace the loader's textures
+        rend.textures = make_texture_set(rend.mod);
+        rend.mod.textures.clear();
+        rend.mod.texture_map.clear();
+    }
+
+    if (!rend.textures.empty() && !rend.tex_cache.is_open())
+    {
+        size_t bytes = 0;
+        for (auto const& tex : rend.textures.textures)
+        {
+            bytes += tex.size_in_bytes();
+        }
+        std::cout << "Textures: " << rend.textures.textures.size() << ", " << bytes / (1024 * 1024) << " MB\n";
+    }
 
     std::cout << "Ready\n";
 
@@ -79,15 +244,162 @@ int main(int argc, char** argv)
         rend.cam.view_all( rend.mod.bbox );
     }
 
-    timer t;
-    for (size_t sample = 1; sample <= rend.spp; ++sample)
+    // Accumulate spp samples
+    auto render_samples = [&]()
+    {
+        timer t;
+        for (size_t sample = 1; sample <= rend.spp; ++sample)
+        {
+            rend.render();
+            std::cout << "sample " << sample << ": " << t.elapsed() << "ms\n";
+
+            if (rend.show_render_stats)
+            {
+                print_render_stats(std::cout, rend.stats);
+            }
+
+            if (rend.ooc.is_open())
+            {
+                auto c = rend.ooc.get_counters();
+                std::cout << "  out-of-core: " << c.hits << " hits, " << c.misses << " misses, "
+                          << c.evictions << " evictions, " << c.resident_bytes / (1024 * 1024) << " of "
+                          << c.total_bytes / (1024 * 1024) << " MB resident\n";
+            }
+
+            if (rend.tex_cache.is_open())
+            {
+                auto c = rend.tex_cache.get_counters();
+                std::cout << "  textures: " << c.hits << " hits, " << c.misses << " misses, "
+                          << c.evictions << " evictions, " << c.resident_bytes / (1024 * 1024) << " of "
+                          << c.total_bytes / (1024 * 1024) << " MB resident";
+
+                if (c.read_errors > 0)
+                {
+                    std::cout << ", " << c.read_errors << " read errors";
+                }
+
+                std::cout << '\n';
+            }
+
+            t.reset();
+        }
+    };
+
+    // Views: camera path, turntable (streaming) or the single camera
+
+    camera_view view{ rend.cam.eye(), rend.cam.center(), rend.cam.up() };
+    std::vector<camera_view> views{ view };
+
+    if (!rend.camera_path_filename.empty())
+    {
+        if (!load_camera_path(rend.camera_path_filename, views))
+        {
+            std::cerr << "Cannot read camera path: " << rend.camera_path_filename << '\n';
+            return EXIT_FAILURE;
+        }
+
+        views = interpolate_camera_path(views, rend.num_frames);
+    }
+    else if (stream.is_open())
+    {
+        views = make_turntable(view, rend.num_frames);
+    }
+
+    bool numbered = !rend.camera_path_filename.empty();
+
+    render_coordinator coordinator;
+
+    if (coordinating)
     {
-        rend.render();
-        std::cout << "sample " << sample << ": " << t.elapsed() << "ms\n";
-        t.reset();
+        bool opened = coordinator.open(
+                rend.coordinator_address,
+                std::chrono::seconds(rend.worker_timeout),
+                std::chrono::seconds(rend.tile_timeout)
+                );
+
+        if (!opened)
+        {
+            std::cerr << "Cannot listen on: " << rend.coordinator_address << '\n';
+            return EXIT_FAILURE;
+        }
+
+        coordinator.wait_for_workers(rend.min_workers);
     }
 
-    rend.save_as_png();
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        // Scene, BVH and render threads are kept, only accumulation restarts
+        rend.cam.look_at(views[i].eye, views[i].center, views[i].up);
+        rend.clear_frame();
+
+        if (views.size() > 1)
+        {
+            std::cout << "frame " << i + 1 << '/' << views.size() << '\n';
+        }
+
+        if (coordinator.is_open())
+        {
+            timer t;
+
+            std::vector<vec4> accum;
+            bool rendered = coordinator.render(
+                    views[i],
+                    static_cast<int>(rend.width),
+                    static_cast<int>(rend.height),
+                    static_cast<unsigned>(rend.spp),
+                    static_cast<unsigned>(rend.tile_size),
+                    static_cast<unsigned>(rend.tile_spp),
+                    accum
+                    );
+
+            if (!rendered)
+            {
+                return EXIT_FAILURE;
+            }
+
+            rend.set_accum(accum.data(), static_cast<unsigned>(rend.spp));
+
+            std::cout << "distributed: " << t.elapsed() << "ms\n";
+        }
+        else
+        {
+            render_samples();
+        }
+
+        if (stream.is_open())
+        {
+            auto rgb = rend.color_rgb8();
+            if (!stream.write_frame(rgb.data()))
+            {
+                std::cerr << "Cannot write frame to stream: " << rend.stream_filename << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!rend.accum_filename.empty())
+        {
+            accum_info info;
+            info.width        = static_cast<uint32_t>(rend.width);
+            info.height       = static_cast<uint32_t>(rend.height);
+            info.sample_first = rend.sample_first;
+            info.sample_count = rend.spp;
+
+            auto name = numbered ? numbered_filename(rend.accum_filename, i + 1, views.size()) : rend.accum_filename;
+
+            if (!write_accum_file(name, info, rend.accum_buffer()))
+            {
+                std::cerr << "Cannot write accumulation buffer: " << name << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (numbered)
+        {
+            rend.save_as_png(numbered_filename(rend.png_filename, i + 1, views.size()));
+        }
+        else
+        {
+            rend.save_as_png(rend.png_filename);
+        }
+    }
 
     return EXIT_SUCCESS;
 }
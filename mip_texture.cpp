@@ -0,0 +1,461 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mip_texture.h"
+#include "parallel_for.h"
+#include "pixel_convert.h"
+#include "texture_cache.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static float const* srgb_to_linear_table()
+{
+    static float const* table = []()
+    {
+        static float t[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+
+    return table;
+}
+
+static vec4 decode(uint32_t texel)
+{
+    float const* lut = srgb_to_linear_table();
+
+    return vec4(
+            lut[texel & 0xFF],
+            lut[(texel >> 8) & 0xFF],
+            lut[(texel >> 16) & 0xFF],
+            (texel >> 24) / 255.0f
+            );
+}
+
+static unsigned wrap(long long i, unsigned n)
+{
+    long long r = i % static_cast<long long>(n);
+    return static_cast<unsigned>(r < 0 ? r + n : r);
+}
+
+// Offset of texel (x, y) of a level inside its page
+static unsigned page_offset(unsigned x, unsigned y)
+{
+    unsigned const T = mip_texture::TileSize;
+    unsigned const P = mip_texture::PageSize;
+
+    unsigned px = x % P;
+    unsigned py = y % P;
+    unsigned tile = (py / T) * (P / T) + px / T;
+    return tile * T * T + (py % T) * T + (px % T);
+}
+
+static size_t page_index(mip_texture::level const& lvl, unsigned x, unsigned y)
+{
+    unsigned const P = mip_texture::PageSize;
+
+    return lvl.first_page + size_t(y / P) * lvl.pages_x + x / P;
+}
+
+// Rows per thread, at least
+static size_t row_grain(mip_texture::level const& lvl)
+{
+    return std::max<size_t>(1, (1 << 16) / lvl.width);
+}
+
+// Box filter in linear space, odd sizes clamp the footprint at the border
+static void downsample(
+        uint8_t*                    dst,
+        mip_texture::level const&   dst_lvl,
+        uint8_t const*              src,
+        mip_texture::level const&   src_lvl
+        )
+{
+    parallel_for(0, dst_lvl.height, row_grain(dst_lvl), [&](size_t first, size_t last)
+    {
+        std::vector<float> row0(src_lvl.width * 4);
+        std::vector<float> row1(src_lvl.width * 4);
+        std::vector<float> out(dst_lvl.width * 4);
+
+        for (size_t y = first; y < last; ++y)
+        {
+            size_t y0 = std::min<size_t>(2 * y, src_lvl.height - 1);
+            size_t y1 = std::min<size_t>(2 * y + 1, src_lvl.height - 1);
+
+            decode_srgb(row0.data(), src + y0 * src_lvl.width * 4, src_lvl.width, SIMDKernel, 1);
+            decode_srgb(row1.data(), src + y1 * src_lvl.width * 4, src_lvl.width, SIMDKernel, 1);
+
+            for (unsigned x = 0; x < dst_lvl.width; ++x)
+            {
+                unsigned x0 = std::min(2 * x, src_lvl.width - 1);
+                unsigned x1 = std::min(2 * x + 1, src_lvl.width - 1);
+
+                for (unsigned c = 0; c < 4; ++c)
+                {
+                    out[x * 4 + c] = 0.25f * (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]);
+                }
+            }
+
+            encode_srgb(dst + y * dst_lvl.width * 4, out.data(), dst_lvl.width, SIMDKernel, 1);
+        }
+    });
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// mip_texture
+//
+
+mip_texture::mip_texture(uint8_t const* pixels, unsigned width, unsigned height)
+{
+    // Level layout
+    unsigned w = std::max(width, 1u);
+    unsigned h = std::max(height, 1u);
+    size_t num_pages = 0;
+
+    for (;;)
+    {
+        level lvl;
+        lvl.width      = w;
+        lvl.height     = h;
+        lvl.pages_x    = (w + PageSize - 1) / PageSize;
+        lvl.first_page = num_pages;
+        levels_.push_back(lvl);
+
+        unsigned pages_y = (h + PageSize - 1) / PageSize;
+        num_pages += size_t(lvl.pages_x) * pages_y;
+
+        if (w == 1 && h == 1)
+        {
+            break;
+        }
+
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    texels_.resize(num_pages * PageTexels);
+
+    auto at = [this](level const& lvl, unsigned x, unsigned y) -> uint32_t&
+    {
+        return texels_[page_index(lvl, x, y) * PageTexels + page_offset(x, y)];
+    };
+
+
+    // Level by level: downsample the previous level (row-major RGBA8, level 0
+    // is the input), then swizzle into pages and tiles
+
+    std::vector<uint8_t> src_pixels;
+    std::vector<uint8_t> dst_pixels;
+    uint8_t const* src = pixels;
+
+    for (size_t l = 0; l < levels_.size(); ++l)
+    {
+        level const& lvl = levels_[l];
+
+        if (l > 0)
+        {
+            dst_pixels.resize(size_t(lvl.width) * lvl.height * 4);
+            downsample(dst_pixels.data(), lvl, src, levels_[l - 1]);
+            src_pixels.swap(dst_pixels);
+            src = src_pixels.data();
+        }
+
+        parallel_for(0, lvl.height, row_grain(lvl), [&](size_t first, size_t last)
+        {
+            for (size_t y = first; y < last; ++y)
+            {
+                for (unsigned x = 0; x < lvl.width; ++x)
+                {
+                    uint8_t const* p = src + (y * lvl.width + x) * 4;
+                    at(lvl, x, static_cast<unsigned>(y))
+                        = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+                }
+            }
+        });
+    }
+
+    constant_ = width * height <= 1;
+    color_ = texels_[0];
+}
+
+mip_texture::mip_texture(texture_cache* cache, size_t first_page, std::vector<level> levels)
+    : levels_(std::move(levels))
+    , cache_(cache)
+    , first_page_(first_page)
+{
+    constant_ = levels_.size() == 1 && levels_[0].width * levels_[0].height <= 1;
+
+    if (constant_)
+    {
+        color_ = cache_->page(first_page_)[0];
+    }
+}
+
+unsigned mip_texture::width() const
+{
+    return levels_.empty() ? 0 : levels_[0].width;
+}
+
+unsigned mip_texture::height() const
+{
+    return levels_.empty() ? 0 : levels_[0].height;
+}
+
+unsigned mip_texture::num_levels() const
+{
+    return static_cast<unsigned>(levels_.size());
+}
+
+std::vector<mip_texture::level> const& mip_texture::levels() const
+{
+    return levels_;
+}
+
+vec4 mip_texture::sample(vec2 const& uv, float lod) const
+{
+    if (levels_.empty())
+    {
+        return vec4(1.0f);
+    }
+
+    if (constant_)
+    {
+        return decode(color_);
+    }
+
+    float max_lod = static_cast<float>(levels_.size() - 1);
+    lod = std::isnan(lod) ? 0.0f : std::clamp(lod, 0.0f, max_lod);
+
+    unsigned l0 = static_cast<unsigned>(lod);
+    float f = lod - static_cast<float>(l0);
+
+    vec4 c0 = bilinear(levels_[l0], uv);
+
+    if (f <= 0.0f || l0 + 1 >= levels_.size())
+    {
+        return c0;
+    }
+
+    vec4 c1 = bilinear(levels_[l0 + 1], uv);
+    return c0 * (1.0f - f) + c1 * f;
+}
+
+vec4 mip_texture::texel(unsigned l, unsigned x, unsigned y) const
+{
+    return decode(fetch(levels_[l], x, y));
+}
+
+size_t mip_texture::num_pages() const
+{
+    return texels_.size() / PageTexels;
+}
+
+uint32_t const* mip_texture::page_data(size_t page) const
+{
+    return texels_.data() + page * PageTexels;
+}
+
+size_t mip_texture::size_in_bytes() const
+{
+    return texels_.size() * sizeof(uint32_t);
+}
+
+uint32_t mip_texture::fetch(level const& lvl, unsigned x, unsigned y) const
+{
+    size_t page = page_index(lvl, x, y);
+
+    uint32_t const* data = cache_ != nullptr
+            ? cache_->page(first_page_ + page)
+            : texels_.data() + page * PageTexels;
+
+    return data[page_offset(x, y)];
+}
+
+vec4 mip_texture::bilinear(level const& lvl, vec2 const& uv) const
+{
+    float x = uv.x * lvl.width - 0.5f;
+    float y = uv.y * lvl.height - 0.5f;
+
+    float fx0 = std::floor(x);
+    float fy0 = std::floor(y);
+    float fx = x - fx0;
+    float fy = y - fy0;
+
+    long long ix = static_cast<long long>(fx0);
+    long long iy = static_cast<long long>(fy0);
+
+    unsigned x0 = wrap(ix, lvl.width);
+    unsigned x1 = wrap(ix + 1, lvl.width);
+    unsigned y0 = wrap(iy, lvl.height);
+    unsigned y1 = wrap(iy + 1, lvl.height);
+
+    vec4 c00 = decode(fetch(lvl, x0, y0));
+    vec4 c10 = decode(fetch(lvl, x1, y0));
+    vec4 c01 = decode(fetch(lvl, x0, y1));
+    vec4 c11 = decode(fetch(lvl, x1, y1));
+
+    return (c00 * (1.0f - fx) + c10 * fx) * (1.0f - fy)
+         + (c01 * (1.0f - fx) + c11 * fx) * fy;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// texture_set
+//
+
+bool texture_set::empty() const
+{
+    return textures.empty();
+}
+
+vec4 texture_set::sample(unsigned material, unsigned prim, float u, float v, float footprint) const
+{
+    if (material >= material_textures.size() || material_textures[material] < 0 || size_t(prim) * 3 + 2 >= tex_coords.size())
+    {
+        return vec4(1.0f);
+    }
+
+    vec2 uv = tex_coords[prim * 3] * (1.0f - u - v)
+            + tex_coords[prim * 3 + 1] * u
+            + tex_coords[prim * 3 + 2] * v;
+
+    // Ray cone LOD: the triangle's texel density times the cone footprint
+    float lod = footprint > 0.0f ? lod_bias[prim] + std::log2(footprint) : 0.0f;
+
+    return textures[material_textures[material]].sample(uv, lod);
+}
+
+// Texture coordinates (moved out of the model) and LOD bias, once textures
+// and material_textures are set
+static void finish_texture_set(texture_set& set, model& mod)
+{
+    // set.tex_coords is empty, this leaves mod.tex_coords empty
+    set.tex_coords.swap(mod.tex_coords);
+
+    set.lod_bias.resize(mod.primitives.size());
+
+    for (size_t i = 0; i < mod.primitives.size(); ++i)
+    {
+        auto const& tri = mod.primitives[i];
+
+        vec2 t0 = set.tex_coords[i * 3];
+        vec2 t1 = set.tex_coords[i * 3 + 1] - t0;
+        vec2 t2 = set.tex_coords[i * 3 + 2] - t0;
+
+        float texels = 1.0f;
+        if (tri.geom_id < set.material_textures.size() && set.material_textures[tri.geom_id] >= 0)
+        {
+            auto const& tex = set.textures[set.material_textures[tri.geom_id]];
+            texels = static_cast<float>(tex.width()) * tex.height();
+        }
+
+        float tex_area = std::abs(t1.x * t2.y - t1.y * t2.x) * texels;
+        float world_area = length(cross(tri.e1, tri.e2));
+
+        // Degenerate mappings sample the base level
+        set.lod_bias[i] = tex_area > 0.0f && world_area > 0.0f
+                ? 0.5f * std::log2(tex_area / world_area)
+                : -1.0e30f;
+    }
+}
+
+texture_set make_texture_set(model& mod)
+{
+    using texel_type = model::texture_type::value_type;
+    static_assert(sizeof(texel_type) == 4, "Expected RGBA8 texels");
+
+    texture_set result;
+
+    if (mod.primitives.empty() || mod.tex_coords.size() < mod.primitives.size() * 3)
+    {
+        return result;
+    }
+
+    // Materials may share textures, build one pyramid per texture
+    std::map<texel_type const*, int> indices;
+
+    for (auto const& tex : mod.textures)
+    {
+        if (tex.width() * tex.height() <= 1)
+        {
+            result.material_textures.push_back(-1);
+            continue;
+        }
+
+        auto it = indices.find(tex.data());
+        if (it == indices.end())
+        {
+            it = indices.emplace(tex.data(), static_cast<int>(result.textures.size())).first;
+
+            result.textures.emplace_back(
+                    reinterpret_cast<uint8_t const*>(tex.data()),
+                    static_cast<unsigned>(tex.width()),
+                    static_cast<unsigned>(tex.height())
+                    );
+        }
+
+        result.material_textures.push_back(it->second);
+    }
+
+    if (result.textures.empty())
+    {
+        return texture_set{};
+    }
+
+    finish_texture_set(result, mod);
+
+    return result;
+}
+
+texture_set make_texture_set(model& mod, texture_cache& cache)
+{
+    texture_set result;
+
+    if (mod.primitives.empty() || mod.tex_coords.size() < mod.primitives.size() * 3)
+    {
+        return result;
+    }
+
+    std::map<std::string, int> indices;
+    for (size_t i = 0; i < cache.num_textures(); ++i)
+    {
+        indices.emplace(cache.texture_name(i), static_cast<int>(i));
+        result.textures.push_back(cache.texture(i));
+    }
+
+    for (auto const& name : mod.texture_filenames)
+    {
+        auto it = indices.find(name);
+        result.material_textures.push_back(it != indices.end() ? it->second : -1);
+    }
+
+    if (result.textures.empty())
+    {
+        return texture_set{};
+    }
+
+    finish_texture_set(result, mod);
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,129 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <visionaray/aligned_vector.h>
+#include <visionaray/math/math.h>
+
+#include <common/model.h>
+
+namespace visionaray
+{
+
+class texture_cache;
+
+//-------------------------------------------------------------------------------------------------
+// RGBA8 sRGB texture with a box-filtered mip pyramid
+//
+// Each level is cut into pages of 32x32 texels (4 KB). Pages are stored in
+// 4x4 texel tiles (64 bytes, one cache line), so nearby texels, e.g. the
+// bilinear footprints of rays of one packet, mostly fall into the same cache
+// lines. Pages are either held in memory or paged in on demand from a
+// texture_cache. Sampling returns linear RGB(A); addressing wraps
+//
+
+class mip_texture
+{
+public:
+
+    static constexpr unsigned TileSize   = 4;
+    static constexpr unsigned PageSize   = 32;
+    static constexpr unsigned PageTexels = PageSize * PageSize;
+
+    struct level
+    {
+        unsigned                width       = 0;
+        unsigned                height      = 0;
+        unsigned                pages_x     = 0;
+        size_t                  first_page  = 0;    // relative to the first page of the texture
+    };
+
+public:
+
+    mip_texture() = default;
+
+    // pixels: width * height RGBA8 sRGB texels, row-major
+    mip_texture(uint8_t const* pixels, unsigned width, unsigned height);
+
+    // Texture whose pages first_page, first_page + 1, ... live in cache
+    mip_texture(texture_cache* cache, size_t first_page, std::vector<level> levels);
+
+    unsigned width() const;
+    unsigned height() const;
+    unsigned num_levels() const;
+
+    std::vector<level> const& levels() const;
+
+    // Trilinear lookup, lod is relative to level 0 (log2 of the footprint in texels)
+    vec4 sample(vec2 const& uv, float lod) const;
+
+    // Texel of level l at (x, y), linear RGBA
+    vec4 texel(unsigned l, unsigned x, unsigned y) const;
+
+    // Pages of the pyramid, in memory textures only
+    size_t num_pages() const;
+    uint32_t const* page_data(size_t page) const;
+
+    // Memory held by the texture (excluding cached pages)
+    size_t size_in_bytes() const;
+
+private:
+
+    std::vector<level>      levels_;
+
+    // In memory pages
+    aligned_vector<uint32_t> texels_;
+
+    // Pages in a cache
+    texture_cache*          cache_      = nullptr;
+    size_t                  first_page_ = 0;
+
+    // Single-color texture (e.g. the loader's dummy texture)
+    bool                    constant_   = false;
+    uint32_t                color_      = 0xFFFFFFFF;
+
+    uint32_t fetch(level const& lvl, unsigned x, unsigned y) const;
+    vec4 bilinear(level const& lvl, vec2 const& uv) const;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Textures and texture coordinates for shading
+//
+
+struct texture_set
+{
+    aligned_vector<mip_texture> textures;
+
+    // Texture per material id, -1 for untextured materials
+    aligned_vector<int>         material_textures;
+
+    // Three per triangle, indexed by prim_id
+    model::tex_coord_list       tex_coords;
+
+    // Per triangle: 0.5 * log2(texture space area / world space area), the
+    // texture space area in texels of the triangle's texture
+    aligned_vector<float>       lod_bias;
+
+    bool empty() const;
+
+    // Texture color at barycentric coordinates (u, v) of triangle prim.
+    // footprint is the width of the ray cone on the surface (world units)
+    vec4 sample(unsigned material, unsigned prim, float u, float v, float footprint) const;
+};
+
+// Build mip pyramids from the loader's textures. Returns an empty set if the
+// model has no texture other than the loader's dummy textures. Otherwise the
+// model's tex_coords are moved into the set
+texture_set make_texture_set(model& mod);
+
+// Texture set over the textures of a cache, matched to the model's materials
+// by file name (model::texture_filenames)
+texture_set make_texture_set(model& mod, texture_cache& cache);
+
+} // namespace visionaray
@@ -0,0 +1,164 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/bvh.h>
+#include <visionaray/intersector.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Work done by occlusion queries, accumulated by the caller
+//
+
+struct occlusion_counters
+{
+    uint64_t queries    = 0;    // ray packets
+    uint64_t nodes      = 0;    // node bounds tests
+    uint64_t prims      = 0;    // primitive tests
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Node stack for the depth-first traversal, holds at most depth + 1 entries.
+// The split builder stops at depth 64, the other builders are not bounded
+// (e.g. LBVH on clustered Morton codes), so deeper trees spill to the heap
+//
+
+class occlusion_stack
+{
+public:
+
+    bool empty() const
+    {
+        return top_ == 0 && spill_.empty();
+    }
+
+    void push(unsigned index)
+    {
+        if (top_ < InlineSize)
+        {
+            inline_[top_++] = index;
+        }
+        else
+        {
+            spill_.push_back(index);
+        }
+    }
+
+    unsigned pop()
+    {
+        if (!spill_.empty())
+        {
+            unsigned index = spill_.back();
+            spill_.pop_back();
+            return index;
+        }
+
+        return inline_[--top_];
+    }
+
+private:
+
+    enum { InlineSize = 64 };
+
+    unsigned                inline_[InlineSize];
+    unsigned                top_ = 0;
+    std::vector<unsigned>   spill_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Any-hit query for (packets of) shadow rays
+//
+// Returns the lanes that hit a primitive with 0 < t < max_t. Unlike the
+// closest-hit traversal, children are visited in storage order without
+// sorting them by entry distance, lanes are retired as soon as they are
+// occluded, and the traversal ends once no lane is left
+//
+
+template <typename R, typename BVH>
+inline simd::mask_type_t<typename R::scalar_type> occluded(
+        R const&                        ray,
+        BVH const&                      bvh,
+        typename R::scalar_type const&  max_t,
+        occlusion_counters&             counters,
+        simd::mask_type_t<typename R::scalar_type> active = true
+        )
+{
+    using S = typename R::scalar_type;
+    using M = simd::mask_type_t<S>;
+
+    M result = false;
+
+    active &= max_t > S(0.0);
+
+    if (!any(active))
+    {
+        return result;
+    }
+
+    ++counters.queries;
+
+    auto inv_dir = S(1.0) / ray.dir;
+
+    occlusion_stack stack;
+    stack.push(0);
+
+    while (!stack.empty())
+    {
+        auto const& node = bvh.node(stack.pop());
+
+        ++counters.nodes;
+
+        auto hr = intersect(ray, node.get_bounds(), inv_dir);
+        M visit = active & hr.hit & (hr.tnear < max_t) & (hr.tfar > S(0.0));
+
+        if (!any(visit))
+        {
+            continue;
+        }
+
+        if (node.is_inner())
+        {
+            stack.push(node.get_child(0));
+            stack.push(node.get_child(1));
+            continue;
+        }
+
+        unsigned first = node.get_first_primitive();
+        unsigned last  = first + node.get_num_primitives();
+
+        for (unsigned i = first; i < last; ++i)
+        {
+            ++counters.prims;
+
+            auto phr = intersect(ray, bvh.primitive(i));
+            result |= visit & phr.hit & (phr.t > S(0.0)) & (phr.t < max_t);
+
+            visit &= !result;
+
+            if (!any(visit))
+            {
+                break;
+            }
+        }
+
+        active &= !result;
+
+        if (!any(active))
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+} // namespace visionaray
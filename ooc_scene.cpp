@@ -0,0 +1,1194 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <ostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ooc_scene.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// File format
+//
+
+namespace
+{
+
+static constexpr uint32_t file_version = 1;
+static constexpr uint64_t file_page_size = 4096;
+static char const file_magic[8] = { 'V', 'S', 'N', 'R', 'O', 'O', 'C', '\0' };
+
+struct file_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t node_size;
+    uint32_t prim_size;
+    uint64_t num_nodes;
+    uint64_t num_prims;         // also number of indices
+    uint64_t num_treelets;
+    uint64_t num_materials;
+    uint64_t nodes_offset;
+    uint64_t indices_offset;
+    uint64_t prims_offset;
+    uint64_t treelets_offset;
+    uint64_t materials_offset;
+    uint64_t file_size;
+    float    bbox_min[3];
+    float    bbox_max[3];
+};
+
+struct file_treelet
+{
+    uint64_t node_first;
+    uint64_t node_count;
+    uint64_t prim_first;
+    uint64_t prim_count;
+};
+
+struct file_material
+{
+    float    ca[3];
+    float    cd[3];
+    float    cs[3];
+    float    ce[3];
+    float    ior[3];
+    float    transmission;
+    float    specular_exp;
+    int32_t  illum;
+};
+
+inline uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+inline void write_padding(std::ostream& out, uint64_t offset)
+{
+    static char const zeros[file_page_size] = {};
+
+    auto pos = static_cast<uint64_t>(out.tellp());
+
+    while (pos < offset)
+    {
+        auto n = std::min<uint64_t>(offset - pos, file_page_size);
+        out.write(zeros, n);
+        pos += n;
+    }
+}
+
+inline void store(float dst[3], vec3 const& v)
+{
+    dst[0] = v.x;
+    dst[1] = v.y;
+    dst[2] = v.z;
+}
+
+inline file_material to_file_material(sg::obj_material const& m)
+{
+    file_material fm;
+    store(fm.ca, m.ca);
+    store(fm.cd, m.cd);
+    store(fm.cs, m.cs);
+    store(fm.ce, m.ce);
+    store(fm.ior, m.ior);
+    fm.transmission = m.transmission;
+    fm.specular_exp = m.specular_exp;
+    fm.illum = m.illum;
+    return fm;
+}
+
+// Element counts that fill a whole number of pages, every treelet block is
+// padded to these so that the next one starts on a page boundary
+inline uint64_t node_granularity()
+{
+    return std::lcm<uint64_t>(sizeof(bvh_node), file_page_size) / sizeof(bvh_node);
+}
+
+inline uint64_t prim_granularity()
+{
+    return std::lcm<uint64_t>(
+            std::lcm<uint64_t>(sizeof(model::triangle_type), file_page_size) / sizeof(model::triangle_type),
+            std::lcm<uint64_t>(sizeof(unsigned), file_page_size) / sizeof(unsigned)
+            );
+}
+
+enum treelet_status
+{
+    Evicted,    // PROT_NONE, pages dropped
+    Armed,      // PROT_NONE, pages resident; next access counts as hit
+    Accessed    // PROT_READ
+};
+
+struct treelet_state
+{
+    treelet_status status   = Evicted;
+    uint64_t       last_use = 0;
+    uint64_t       bytes    = 0;
+};
+
+} // namespace
+
+
+//-------------------------------------------------------------------------------------------------
+// Private implementation
+//
+
+struct ooc_scene::impl
+{
+    int                                 fd          = -1;
+    char*                               base        = nullptr;
+    size_t                              size        = 0;
+
+    file_header                         header;
+
+    bvh_node const*                     nodes       = nullptr;
+    unsigned const*                     indices     = nullptr;
+    model::triangle_type const*         prims       = nullptr;
+
+    std::vector<file_treelet>           treelets;
+    std::vector<treelet_state>          states;
+    aligned_vector<sg::obj_material>    materials;
+    aabb                                bbox;
+
+    bool                                tracking    = false;
+    uint64_t                            budget      = 0;
+    uint64_t                            clock       = 0;
+    counters                            stats;
+
+    std::atomic_flag                    lock        = ATOMIC_FLAG_INIT;
+
+    // Critical sections are short: spin a little, then back off with
+    // nanosleep() (async-signal-safe, unlike a mutex) instead of burning the
+    // CPU of a render thread
+    void acquire()
+    {
+        for (unsigned spins = 0; lock.test_and_set(std::memory_order_acquire); ++spins)
+        {
+            if (spins >= 64)
+            {
+                timespec ts = { 0, 50000 };
+                nanosleep(&ts, nullptr);
+            }
+        }
+    }
+
+    void release()
+    {
+        lock.clear(std::memory_order_release);
+    }
+
+    template <typename Func>
+    void for_each_range(size_t t, Func func)
+    {
+        auto const& tl = treelets[t];
+
+        func(header.nodes_offset + tl.node_first * sizeof(bvh_node), tl.node_count * sizeof(bvh_node));
+        func(header.indices_offset + tl.prim_first * sizeof(unsigned), tl.prim_count * sizeof(unsigned));
+        func(header.prims_offset + tl.prim_first * sizeof(model::triangle_type), tl.prim_count * sizeof(model::triangle_type));
+    }
+
+    void protect(size_t t, int prot)
+    {
+        for_each_range(t, [&](uint64_t offset, uint64_t len)
+        {
+            if (len > 0)
+            {
+                mprotect(base + offset, len, prot);
+            }
+        });
+    }
+
+    void evict(size_t t)
+    {
+        for_each_range(t, [&](uint64_t offset, uint64_t len)
+        {
+            if (len > 0)
+            {
+                mprotect(base + offset, len, PROT_NONE);
+                madvise(base + offset, len, MADV_DONTNEED);
+                posix_fadvise(fd, offset, len, POSIX_FADV_DONTNEED);
+            }
+        });
+
+        states[t].status = Evicted;
+        stats.resident_bytes -= states[t].bytes;
+        ++stats.evictions;
+    }
+
+    // Evict least recently used treelets until the budget is met. Treelet 0
+    // (the top levels of the BVH) is pinned
+    void evict_to_budget()
+    {
+        if (stats.resident_bytes <= budget)
+        {
+            return;
+        }
+
+        std::vector<size_t> resident;
+
+        for (size_t t = 1; t < states.size(); ++t)
+        {
+            if (states[t].status != Evicted)
+            {
+                resident.push_back(t);
+            }
+        }
+
+        std::sort(resident.begin(), resident.end(), [&](size_t a, size_t b)
+        {
+            return states[a].last_use < states[b].last_use;
+        });
+
+        for (size_t i = 0; i < resident.size() && stats.resident_bytes > budget; ++i)
+        {
+            evict(resident[i]);
+        }
+    }
+
+    // Treelet that owns addr, -1 if addr is not inside one of the arrays
+    long find_treelet(char const* addr) const
+    {
+        auto offset = static_cast<uint64_t>(addr - base);
+
+        auto find = [&](uint64_t index, uint64_t file_treelet::*first)
+        {
+            auto it = std::upper_bound(
+                    treelets.begin(),
+                    treelets.end(),
+                    index,
+                    [first](uint64_t i, file_treelet const& tl) { return i < tl.*first; }
+                    );
+            return static_cast<long>(it - treelets.begin()) - 1;
+        };
+
+        if (offset >= header.nodes_offset && offset < header.nodes_offset + header.num_nodes * sizeof(bvh_node))
+        {
+            return find((offset - header.nodes_offset) / sizeof(bvh_node), &file_treelet::node_first);
+        }
+
+        if (offset >= header.indices_offset && offset < header.indices_offset + header.num_prims * sizeof(unsigned))
+        {
+            return find((offset - header.indices_offset) / sizeof(unsigned), &file_treelet::prim_first);
+        }
+
+        if (offset >= header.prims_offset && offset < header.prims_offset + header.num_prims * sizeof(model::triangle_type))
+        {
+            return find((offset - header.prims_offset) / sizeof(model::triangle_type), &file_treelet::prim_first);
+        }
+
+        return -1;
+    }
+
+    // Called from the SIGSEGV handler. Only makes the treelet accessible,
+    // eviction is left to end_frame(), so the budget may be exceeded within
+    // a frame
+    bool fault(void* addr)
+    {
+        auto p = static_cast<char const*>(addr);
+
+        if (p < base || p >= base + size)
+        {
+            return false;
+        }
+
+        long t = find_treelet(p);
+
+        if (t <= 0)
+        {
+            return false;
+        }
+
+        acquire();
+
+        auto& s = states[t];
+
+        if (s.status == Evicted)
+        {
+            ++stats.misses;
+            stats.resident_bytes += s.bytes;
+        }
+        else if (s.status == Armed)
+        {
+            ++stats.hits;
+        }
+
+        // Accessed: another thread got here first, nothing to do
+
+        if (s.status != Accessed)
+        {
+            s.status = Accessed;
+            s.last_use = ++clock;
+            protect(t, PROT_READ);
+        }
+
+        release();
+
+        return true;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// SIGSEGV handler, there can only be one active scene
+//
+
+static std::atomic<ooc_scene*> active_scene(nullptr);
+static struct sigaction previous_action;
+
+bool handle_ooc_fault(void* addr)
+{
+    auto self = active_scene.load();
+    return self != nullptr && self->impl_->fault(addr);
+}
+
+static void segv_handler(int /* sig */, siginfo_t* info, void* /* ctx */)
+{
+    if (info->si_code == SEGV_ACCERR && handle_ooc_fault(info->si_addr))
+    {
+        return;
+    }
+
+    // Not ours: reinstall the previous handler and let the access fault again
+    sigaction(SIGSEGV, &previous_action, nullptr);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// ooc_scene
+//
+
+ooc_scene::ooc_scene()
+    : impl_(new impl)
+{
+}
+
+ooc_scene::~ooc_scene()
+{
+    close();
+}
+
+bool ooc_scene::open(std::string const& filename, size_t budget_bytes)
+{
+    close();
+
+    impl_->fd = ::open(filename.c_str(), O_RDONLY);
+
+    if (impl_->fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    auto& header = impl_->header;
+
+    if (fstat(impl_->fd, &st) != 0
+     || pread(impl_->fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+     || std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0
+     || header.version != file_version
+     || header.node_size != sizeof(bvh_node)
+     || header.prim_size != sizeof(model::triangle_type)
+     || header.file_size != static_cast<uint64_t>(st.st_size))
+    {
+        std::cerr << "Warning: not a valid out-of-core cache file: " << filename << '\n';
+        close();
+        return false;
+    }
+
+    impl_->size = header.file_size;
+    void* ptr = mmap(nullptr, impl_->size, PROT_READ, MAP_PRIVATE, impl_->fd, 0);
+
+    if (ptr == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    impl_->base    = static_cast<char*>(ptr);
+    impl_->nodes   = reinterpret_cast<bvh_node const*>(impl_->base + header.nodes_offset);
+    impl_->indices = reinterpret_cast<unsigned const*>(impl_->base + header.indices_offset);
+    impl_->prims   = reinterpret_cast<model::triangle_type const*>(impl_->base + header.prims_offset);
+
+    auto treelets = reinterpret_cast<file_treelet const*>(impl_->base + header.treelets_offset);
+    impl_->treelets.assign(treelets, treelets + header.num_treelets);
+
+    auto materials = reinterpret_cast<file_material const*>(impl_->base + header.materials_offset);
+    impl_->materials.resize(header.num_materials);
+
+    for (size_t i = 0; i < header.num_materials; ++i)
+    {
+        auto const& fm = materials[i];
+        auto& m = impl_->materials[i];
+        m.ca = vec3(fm.ca[0], fm.ca[1], fm.ca[2]);
+        m.cd = vec3(fm.cd[0], fm.cd[1], fm.cd[2]);
+        m.cs = vec3(fm.cs[0], fm.cs[1], fm.cs[2]);
+        m.ce = vec3(fm.ce[0], fm.ce[1], fm.ce[2]);
+        m.ior = vec3(fm.ior[0], fm.ior[1], fm.ior[2]);
+        m.transmission = fm.transmission;
+        m.specular_exp = fm.specular_exp;
+        m.illum = fm.illum;
+    }
+
+    impl_->bbox = aabb(
+            vec3(header.bbox_min[0], header.bbox_min[1], header.bbox_min[2]),
+            vec3(header.bbox_max[0], header.bbox_max[1], header.bbox_max[2])
+            );
+
+    impl_->states.assign(impl_->treelets.size(), treelet_state());
+    impl_->stats = counters();
+    impl_->stats.num_treelets = impl_->treelets.size();
+    impl_->stats.total_bytes = header.file_size;
+    impl_->budget = budget_bytes;
+    impl_->clock = 0;
+
+    for (size_t t = 0; t < impl_->treelets.size(); ++t)
+    {
+        impl_->for_each_range(t, [&](uint64_t, uint64_t len) { impl_->states[t].bytes += len; });
+    }
+
+    // The top levels are pinned
+    impl_->states[0].status = Accessed;
+    impl_->stats.resident_bytes = impl_->states[0].bytes;
+
+    // Page protection only works if treelets are aligned to system pages
+    long system_page_size = sysconf(_SC_PAGESIZE);
+    impl_->tracking = budget_bytes > 0
+                   && system_page_size > 0
+                   && header.page_size % system_page_size == 0
+                   && active_scene.load() == nullptr;
+
+    if (budget_bytes > 0 && !impl_->tracking)
+    {
+        std::cerr << "Warning: out-of-core residency tracking not available, relying on the OS pager\n";
+    }
+
+    if (impl_->tracking)
+    {
+        for (size_t t = 1; t < impl_->treelets.size(); ++t)
+        {
+            impl_->protect(t, PROT_NONE);
+        }
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = segv_handler;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+
+        active_scene = this;
+        sigaction(SIGSEGV, &action, &previous_action);
+    }
+
+    return true;
+}
+
+void ooc_scene::close()
+{
+    if (impl_->tracking)
+    {
+        sigaction(SIGSEGV, &previous_action, nullptr);
+        active_scene = nullptr;
+        impl_->tracking = false;
+    }
+
+    if (impl_->base != nullptr)
+    {
+        munmap(impl_->base, impl_->size);
+        impl_->base = nullptr;
+    }
+
+    if (impl_->fd >= 0)
+    {
+        ::close(impl_->fd);
+        impl_->fd = -1;
+    }
+
+    impl_->treelets.clear();
+    impl_->states.clear();
+}
+
+bool ooc_scene::is_open() const
+{
+    return impl_->base != nullptr;
+}
+
+ooc_scene::bvh_ref ooc_scene::ref() const
+{
+    auto const& header = impl_->header;
+
+    return bvh_ref(
+            impl_->prims,
+            impl_->prims + header.num_prims,
+            impl_->nodes,
+            impl_->nodes + header.num_nodes,
+            impl_->indices,
+            impl_->indices + header.num_prims
+            );
+}
+
+aabb const& ooc_scene::bbox() const
+{
+    return impl_->bbox;
+}
+
+aligned_vector<sg::obj_material> const& ooc_scene::materials() const
+{
+    return impl_->materials;
+}
+
+void ooc_scene::end_frame()
+{
+    if (!impl_->tracking)
+    {
+        return;
+    }
+
+    impl_->acquire();
+
+    for (size_t t = 1; t < impl_->states.size(); ++t)
+    {
+        if (impl_->states[t].status == Accessed)
+        {
+            impl_->protect(t, PROT_NONE);
+            impl_->states[t].status = Armed;
+        }
+    }
+
+    impl_->evict_to_budget();
+
+    impl_->release();
+}
+
+ooc_scene::counters ooc_scene::get_counters() const
+{
+    impl_->acquire();
+    auto result = impl_->stats;
+    impl_->release();
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// ooc_scene_writer
+//
+
+namespace
+{
+
+// Bits per axis of the Morton cells the buckets are made of (2^18 cells)
+static constexpr unsigned morton_bits = 6;
+
+// Triangles per read from / write to the temporary files
+static constexpr size_t io_chunk_prims = size_t(1) << 16;
+
+// Triangles buffered per bucket while distributing
+static constexpr size_t bucket_buffer_prims = 4096;
+
+inline uint32_t expand_bits(uint32_t v)
+{
+    uint32_t result = 0;
+
+    for (unsigned i = 0; i < morton_bits; ++i)
+    {
+        result |= ((v >> i) & 1u) << (3 * i);
+    }
+
+    return result;
+}
+
+// Call func(prims, count) for consecutive chunks of a triangle file
+template <typename Func>
+bool for_each_chunk(std::string const& filename, uint64_t first, uint64_t count, Func func)
+{
+    std::ifstream in(filename, std::ios::binary);
+    in.seekg(first * sizeof(model::triangle_type));
+
+    model::triangle_list chunk(std::min<uint64_t>(count, io_chunk_prims));
+
+    for (uint64_t i = 0; i < count; i += chunk.size())
+    {
+        auto n = std::min<uint64_t>(count - i, chunk.size());
+
+        if (!in.read(reinterpret_cast<char*>(chunk.data()), n * sizeof(model::triangle_type)))
+        {
+            return false;
+        }
+
+        func(chunk.data(), static_cast<size_t>(n));
+    }
+
+    return true;
+}
+
+// Where a node is stored while its treelet is cut: the top levels, or the
+// node block of the current treelet (indices relative to the treelet area)
+struct cut_placement
+{
+    unsigned old_index;
+    unsigned new_index;
+    bool     in_top;
+};
+
+} // namespace
+
+struct ooc_scene_writer::impl
+{
+    std::string             filename;
+    size_t                  max_treelet_prims;
+    size_t                  max_bucket_prims;
+
+    std::string             spill_filename;     // triangles in the order added
+    std::string             bucket_filename;    // triangles grouped by bucket
+    std::string             nodes_filename;     // treelet nodes, children relative to the treelet area
+    std::string             prims_filename;     // treelet primitives
+
+    std::ofstream           spill;
+    uint64_t                num_prims = 0;
+    aabb                    bbox;
+    aabb                    centroid_bbox;
+    bool                    ok = true;
+
+    // Top levels (treelet 0): tree over the buckets and the upper levels of
+    // the bucket BVHs. Nodes with links_treelets set point into the treelet area
+    aligned_vector<bvh_node> top;
+    std::vector<char>       links_treelets;
+
+    std::vector<file_treelet> treelets;
+    uint64_t                nodes_written = 0;
+    uint64_t                prims_written = 0;
+
+    uint32_t cell(model::triangle_type const& tri) const
+    {
+        vec3 c = tri.v1 + (tri.e1 + tri.e2) / 3.0f;
+        vec3 size = max(centroid_bbox.max - centroid_bbox.min, vec3(1.0e-30f));
+        vec3 rel = (c - centroid_bbox.min) / size;
+
+        float cells = static_cast<float>(1u << morton_bits);
+        auto axis = [&](float f)
+        {
+            return static_cast<uint32_t>(std::min(std::max(f * cells, 0.0f), cells - 1.0f));
+        };
+
+        return expand_bits(axis(rel.x)) | (expand_bits(axis(rel.y)) << 1) | (expand_bits(axis(rel.z)) << 2);
+    }
+
+    void remove_temporaries() const
+    {
+        std::remove(spill_filename.c_str());
+        std::remove(bucket_filename.c_str());
+        std::remove(nodes_filename.c_str());
+        std::remove(prims_filename.c_str());
+    }
+
+    bool distribute(std::vector<uint64_t>& bucket_first, std::vector<uint64_t>& bucket_count);
+    bool cut(index_bvh<model::triangle_type> const& bvh, unsigned root_slot, std::ofstream& nodes_out, std::ofstream& prims_out);
+    bool assemble(aligned_vector<sg::obj_material> const& materials);
+};
+
+// Group the spilled triangles into buckets of consecutive Morton cells
+bool ooc_scene_writer::impl::distribute(std::vector<uint64_t>& bucket_first, std::vector<uint64_t>& bucket_count)
+{
+    size_t num_cells = size_t(1) << (3 * morton_bits);
+    std::vector<uint64_t> cell_counts(num_cells, 0);
+
+    bool read_ok = for_each_chunk(spill_filename, 0, num_prims, [&](model::triangle_type const* prims, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            ++cell_counts[cell(prims[i])];
+        }
+    });
+
+    if (!read_ok)
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> cell_bucket(num_cells, 0);
+    uint64_t total = 0;
+
+    for (size_t c = 0; c < num_cells; ++c)
+    {
+        if (cell_counts[c] == 0)
+        {
+            continue;
+        }
+
+        // A single cell may exceed the bucket size, it is not split further
+        if (bucket_count.empty() || (bucket_count.back() > 0 && bucket_count.back() + cell_counts[c] > max_bucket_prims))
+        {
+            bucket_first.push_back(total);
+            bucket_count.push_back(0);
+        }
+
+        cell_bucket[c] = static_cast<uint32_t>(bucket_count.size() - 1);
+        bucket_count.back() += cell_counts[c];
+        total += cell_counts[c];
+    }
+
+    std::ofstream out(bucket_filename, std::ios::binary);
+    std::vector<model::triangle_list> buffers(bucket_count.size());
+    std::vector<uint64_t> written(bucket_count.size(), 0);
+
+    auto flush = [&](size_t b)
+    {
+        out.seekp((bucket_first[b] + written[b]) * sizeof(model::triangle_type));
+        out.write(reinterpret_cast<char const*>(buffers[b].data()), buffers[b].size() * sizeof(model::triangle_type));
+        written[b] += buffers[b].size();
+        buffers[b].clear();
+    };
+
+    read_ok = for_each_chunk(spill_filename, 0, num_prims, [&](model::triangle_type const* prims, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto b = cell_bucket[cell(prims[i])];
+            buffers[b].push_back(prims[i]);
+
+            if (buffers[b].size() >= bucket_buffer_prims)
+            {
+                flush(b);
+            }
+        }
+    });
+
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        flush(b);
+    }
+
+    std::remove(spill_filename.c_str());
+
+    return read_ok && out.good();
+}
+
+// Cut a bucket BVH into treelets as ooc_scene expects them: nodes of
+// subtrees with more than max_treelet_prims references go to the top
+// levels, the others are written as treelets. The root replaces the node at
+// root_slot in the top levels
+bool ooc_scene_writer::impl::cut(
+        index_bvh<model::triangle_type> const&  bvh,
+        unsigned                                root_slot,
+        std::ofstream&                          nodes_out,
+        std::ofstream&                          prims_out
+        )
+{
+    auto const& nodes = bvh.nodes();
+    auto const& indices = bvh.indices();
+    auto const& prims = bvh.primitives();
+
+    // Number of primitive references per subtree
+    std::vector<uint64_t> refs(nodes.size(), 0);
+    std::vector<unsigned> order;
+    std::vector<unsigned> stack(1, 0);
+
+    while (!stack.empty())
+    {
+        auto index = stack.back();
+        stack.pop_back();
+        order.push_back(index);
+
+        if (nodes[index].is_inner())
+        {
+            stack.push_back(nodes[index].get_child(0));
+            stack.push_back(nodes[index].get_child(1));
+        }
+    }
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        auto const& n = nodes[*it];
+        refs[*it] = n.is_leaf() ? n.get_num_primitives() : refs[n.get_child(0)] + refs[n.get_child(1)];
+    }
+
+    // Upper levels: breadth first until subtrees are small enough
+    top[root_slot] = nodes[0];
+    std::vector<cut_placement> queue(1, cut_placement{ 0, root_slot, true });
+    std::vector<cut_placement> treelet_roots;
+
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        auto p = queue[q];
+        auto const& n = nodes[p.old_index];
+
+        if (n.is_leaf() || refs[p.old_index] <= max_treelet_prims)
+        {
+            treelet_roots.push_back(p);
+            continue;
+        }
+
+        auto first = static_cast<unsigned>(top.size());
+        top.push_back(nodes[n.get_child(0)]);
+        top.push_back(nodes[n.get_child(1)]);
+        links_treelets.resize(top.size(), 0);
+        set_inner(top[p.new_index], n.get_bounds(), first);
+
+        queue.push_back({ n.get_child(0), first, true });
+        queue.push_back({ n.get_child(1), first + 1, true });
+    }
+
+    // Padding, never referenced by a leaf
+    model::triangle_type dummy;
+    dummy.v1 = vec3(0.0f);
+    dummy.e1 = vec3(0.0f);
+    dummy.e2 = vec3(0.0f);
+    dummy.prim_id = 0;
+    dummy.geom_id = 0;
+
+    aligned_vector<bvh_node> tnodes;
+    model::triangle_list tprims;
+
+    for (auto const& root : treelet_roots)
+    {
+        tnodes.clear();
+        tprims.clear();
+
+        auto node_at = [&](cut_placement const& p) -> bvh_node&
+        {
+            return p.in_top ? top[p.new_index] : tnodes[p.new_index - nodes_written];
+        };
+
+        std::vector<cut_placement> st(1, root);
+
+        while (!st.empty())
+        {
+            auto p = st.back();
+            st.pop_back();
+
+            auto const& n = nodes[p.old_index];
+
+            if (n.is_leaf())
+            {
+                auto first = static_cast<unsigned>(prims_written + tprims.size());
+
+                for (unsigned i = 0; i < n.get_num_primitives(); ++i)
+                {
+                    tprims.push_back(prims[indices[n.get_first_primitive() + i]]);
+                }
+
+                set_leaf(node_at(p), n.get_bounds(), first, n.get_num_primitives());
+            }
+            else
+            {
+                auto first = static_cast<unsigned>(nodes_written + tnodes.size());
+                tnodes.resize(tnodes.size() + 2);
+                set_inner(node_at(p), n.get_bounds(), first);
+
+                if (p.in_top)
+                {
+                    links_treelets[p.new_index] = 1;
+                }
+
+                st.push_back({ n.get_child(0), first, false });
+                st.push_back({ n.get_child(1), first + 1, false });
+            }
+        }
+
+        tnodes.resize(align_up(tnodes.size(), node_granularity()));
+        tprims.resize(align_up(tprims.size(), prim_granularity()), dummy);
+
+        nodes_out.write(reinterpret_cast<char const*>(tnodes.data()), tnodes.size() * sizeof(bvh_node));
+        prims_out.write(reinterpret_cast<char const*>(tprims.data()), tprims.size() * sizeof(model::triangle_type));
+
+        // node_first is relative to the treelet area until assemble()
+        treelets.push_back({ nodes_written, tnodes.size(), prims_written, tprims.size() });
+
+        nodes_written += tnodes.size();
+        prims_written += tprims.size();
+    }
+
+    return nodes_out.good() && prims_out.good();
+}
+
+// Write the cache file from the top levels and the treelet temporaries
+bool ooc_scene_writer::impl::assemble(aligned_vector<sg::obj_material> const& materials)
+{
+    top.resize(align_up(top.size(), node_granularity()));
+    links_treelets.resize(top.size(), 0);
+
+    auto top_size = static_cast<unsigned>(top.size());
+
+    auto relocate = [top_size](bvh_node& n)
+    {
+        set_inner(n, n.get_bounds(), n.get_child(0) + top_size);
+    };
+
+    for (size_t i = 0; i < top.size(); ++i)
+    {
+        if (links_treelets[i])
+        {
+            relocate(top[i]);
+        }
+    }
+
+    treelets[0] = { 0, top.size(), 0, 0 };
+
+    for (size_t t = 1; t < treelets.size(); ++t)
+    {
+        treelets[t].node_first += top.size();
+    }
+
+    std::vector<file_material> out_materials;
+
+    for (auto const& m : materials)
+    {
+        out_materials.push_back(to_file_material(m));
+    }
+
+    file_header header = {};
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version          = file_version;
+    header.page_size        = file_page_size;
+    header.node_size        = sizeof(bvh_node);
+    header.prim_size        = sizeof(model::triangle_type);
+    header.num_nodes        = top.size() + nodes_written;
+    header.num_prims        = prims_written;
+    header.num_treelets     = treelets.size();
+    header.num_materials    = out_materials.size();
+    header.nodes_offset     = file_page_size;
+    header.indices_offset   = align_up(header.nodes_offset + header.num_nodes * sizeof(bvh_node), file_page_size);
+    header.prims_offset     = align_up(header.indices_offset + header.num_prims * sizeof(unsigned), file_page_size);
+    header.treelets_offset  = align_up(header.prims_offset + header.num_prims * sizeof(model::triangle_type), file_page_size);
+    header.materials_offset = header.treelets_offset + treelets.size() * sizeof(file_treelet);
+    header.file_size        = header.materials_offset + out_materials.size() * sizeof(file_material);
+    store(header.bbox_min, bbox.min);
+    store(header.bbox_max, bbox.max);
+
+    std::ofstream file(filename, std::ios::binary);
+
+    if (!file.good())
+    {
+        return false;
+    }
+
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    // Nodes: top levels, then the treelets with children moved behind the top levels
+    write_padding(file, header.nodes_offset);
+    file.write(reinterpret_cast<char const*>(top.data()), top.size() * sizeof(bvh_node));
+
+    {
+        std::ifstream in(nodes_filename, std::ios::binary);
+        aligned_vector<bvh_node> chunk(node_granularity() * 64);
+
+        for (uint64_t i = 0; i < nodes_written; i += chunk.size())
+        {
+            auto n = std::min<uint64_t>(nodes_written - i, chunk.size());
+
+            if (!in.read(reinterpret_cast<char*>(chunk.data()), n * sizeof(bvh_node)))
+            {
+                return false;
+            }
+
+            for (uint64_t j = 0; j < n; ++j)
+            {
+                if (chunk[j].is_inner())
+                {
+                    relocate(chunk[j]);
+                }
+            }
+
+            file.write(reinterpret_cast<char const*>(chunk.data()), n * sizeof(bvh_node));
+        }
+    }
+
+    // Primitives are stored in leaf order, indices are the identity
+    write_padding(file, header.indices_offset);
+
+    {
+        std::vector<unsigned> chunk(io_chunk_prims);
+
+        for (uint64_t i = 0; i < prims_written; i += chunk.size())
+        {
+            auto n = std::min<uint64_t>(prims_written - i, chunk.size());
+            std::iota(chunk.begin(), chunk.begin() + n, static_cast<unsigned>(i));
+            file.write(reinterpret_cast<char const*>(chunk.data()), n * sizeof(unsigned));
+        }
+    }
+
+    write_padding(file, header.prims_offset);
+
+    bool read_ok = for_each_chunk(prims_filename, 0, prims_written, [&](model::triangle_type const* prims, size_t n)
+    {
+        file.write(reinterpret_cast<char const*>(prims), n * sizeof(model::triangle_type));
+    });
+
+    write_padding(file, header.treelets_offset);
+    file.write(reinterpret_cast<char const*>(treelets.data()), treelets.size() * sizeof(file_treelet));
+    file.write(reinterpret_cast<char const*>(out_materials.data()), out_materials.size() * sizeof(file_material));
+
+    return read_ok && file.good();
+}
+
+ooc_scene_writer::ooc_scene_writer(
+        std::string const&  filename,
+        size_t              max_treelet_prims,
+        size_t              max_bucket_prims
+        )
+    : impl_(new impl)
+{
+    impl_->filename = filename;
+    impl_->max_treelet_prims = max_treelet_prims;
+    impl_->max_bucket_prims = std::max(max_bucket_prims, max_treelet_prims);
+    impl_->spill_filename = filename + ".spill";
+    impl_->bucket_filename = filename + ".buckets";
+    impl_->nodes_filename = filename + ".nodes";
+    impl_->prims_filename = filename + ".prims";
+
+    impl_->bbox.invalidate();
+    impl_->centroid_bbox.invalidate();
+
+    impl_->spill.open(impl_->spill_filename, std::ios::binary);
+    impl_->ok = impl_->spill.good();
+}
+
+ooc_scene_writer::~ooc_scene_writer()
+{
+    impl_->spill.close();
+    impl_->remove_temporaries();
+}
+
+bool ooc_scene_writer::add(model::triangle_type const* prims, size_t count)
+{
+    if (!impl_->ok)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const& tri = prims[i];
+
+        impl_->bbox = combine(impl_->bbox, tri.v1);
+        impl_->bbox = combine(impl_->bbox, tri.v1 + tri.e1);
+        impl_->bbox = combine(impl_->bbox, tri.v1 + tri.e2);
+        impl_->centroid_bbox = combine(impl_->centroid_bbox, tri.v1 + (tri.e1 + tri.e2) / 3.0f);
+    }
+
+    impl_->spill.write(reinterpret_cast<char const*>(prims), count * sizeof(model::triangle_type));
+    impl_->num_prims += count;
+    impl_->ok = impl_->spill.good();
+
+    return impl_->ok;
+}
+
+bool ooc_scene_writer::finish(aligned_vector<sg::obj_material> const& materials)
+{
+    impl_->spill.close();
+
+    std::vector<uint64_t> bucket_first;
+    std::vector<uint64_t> bucket_count;
+
+    if (!impl_->ok || impl_->num_prims == 0 || !impl_->distribute(bucket_first, bucket_count))
+    {
+        return false;
+    }
+
+    // Tree over the buckets in Morton order, halving the bucket range. Bucket
+    // roots are placed by cut()
+    struct top_entry
+    {
+        size_t   first_bucket;
+        size_t   last_bucket;
+        unsigned child;         // 0 for bucket roots
+    };
+
+    size_t num_buckets = bucket_count.size();
+
+    std::vector<top_entry> entries(1, top_entry{ 0, num_buckets, 0 });
+    std::vector<unsigned> bucket_slot(num_buckets);
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto e = entries[i];
+
+        if (e.last_bucket - e.first_bucket == 1)
+        {
+            bucket_slot[e.first_bucket] = static_cast<unsigned>(i);
+            continue;
+        }
+
+        size_t mid = (e.first_bucket + e.last_bucket) / 2;
+        entries[i].child = static_cast<unsigned>(entries.size());
+        entries.push_back({ e.first_bucket, mid, 0 });
+        entries.push_back({ mid, e.last_bucket, 0 });
+    }
+
+    impl_->top.resize(entries.size());
+    impl_->links_treelets.assign(entries.size(), 0);
+    impl_->treelets.assign(1, file_treelet{});
+
+    std::ofstream nodes_out(impl_->nodes_filename, std::ios::binary);
+    std::ofstream prims_out(impl_->prims_filename, std::ios::binary);
+    std::vector<aabb> bucket_bounds(num_buckets);
+
+    for (size_t b = 0; b < num_buckets; ++b)
+    {
+        model::triangle_list prims(bucket_count[b]);
+
+        std::ifstream in(impl_->bucket_filename, std::ios::binary);
+        in.seekg(bucket_first[b] * sizeof(model::triangle_type));
+
+        if (!in.read(reinterpret_cast<char*>(prims.data()), prims.size() * sizeof(model::triangle_type)))
+        {
+            return false;
+        }
+
+        binned_sah_builder builder;
+        auto bvh = builder.build(index_bvh<model::triangle_type>{}, prims.data(), prims.size());
+
+        bucket_bounds[b] = bvh.nodes()[0].get_bounds();
+
+        if (!impl_->cut(bvh, bucket_slot[b], nodes_out, prims_out))
+        {
+            return false;
+        }
+    }
+
+    nodes_out.close();
+    prims_out.close();
+    std::remove(impl_->bucket_filename.c_str());
+
+    // Bounds of the tree over the buckets, children come after their parents
+    std::vector<aabb> entry_bounds(entries.size());
+
+    for (size_t i = entries.size(); i-- > 0; )
+    {
+        auto const& e = entries[i];
+
+        if (e.child == 0)
+        {
+            entry_bounds[i] = bucket_bounds[e.first_bucket];
+        }
+        else
+        {
+            entry_bounds[i] = combine(entry_bounds[e.child], entry_bounds[e.child + 1]);
+            set_inner(impl_->top[i], entry_bounds[i], e.child);
+        }
+    }
+
+    bool result = impl_->assemble(materials);
+
+    impl_->remove_temporaries();
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,126 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <visionaray/aligned_vector.h>
+#include <visionaray/bvh.h>
+
+#include <common/model.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Streaming cache writer
+//
+// Creates the cache file without holding the scene or its BVH in memory.
+// Triangles are spilled to a temporary file as they are added and then
+// distributed into spatially coherent buckets (consecutive cells in Morton
+// order of the triangle centroids) of at most max_bucket_prims triangles.
+// Each bucket gets a binned SAH BVH of its own that is cut into treelets and
+// written right away; a top-level tree over the buckets joins them. Peak
+// memory is about one bucket and its BVH. Temporaries are placed next to
+// the cache file
+//
+
+class ooc_scene_writer
+{
+public:
+
+    ooc_scene_writer(
+            std::string const&  filename,
+            size_t              max_treelet_prims,
+            size_t              max_bucket_prims = size_t(1) << 22
+            );
+   ~ooc_scene_writer();
+
+    ooc_scene_writer(ooc_scene_writer const&) = delete;
+    ooc_scene_writer& operator=(ooc_scene_writer const&) = delete;
+
+    // Add triangles (in any order)
+    bool add(model::triangle_type const* prims, size_t count);
+
+    // Build and write the cache file
+    bool finish(aligned_vector<sg::obj_material> const& materials);
+
+private:
+
+    struct impl;
+    std::unique_ptr<impl> impl_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Out-of-core geometry and BVH
+//
+// The BVH is cut into treelets (subtrees with at most max_treelet_prims
+// primitive references). Nodes, indices and primitives of each treelet are
+// stored contiguously and page-aligned in a memory-mapped cache file, so that
+// treelets can be protected, faulted in and evicted independently. Treelets
+// are faulted in on first access (caught with SIGSEGV on PROT_NONE pages).
+// Between frames (end_frame()) access tracking is reset and the least
+// recently used ones are evicted with madvise(MADV_DONTNEED) until the
+// resident size is within the budget. "Recently used" has frame granularity,
+// and a frame whose working set is larger than the budget exceeds it until
+// the frame ends
+//
+
+class ooc_scene
+{
+public:
+
+    using bvh_type = index_bvh<model::triangle_type>;
+    using bvh_ref  = bvh_type::bvh_ref;
+
+    struct counters
+    {
+        uint64_t hits           = 0;    // first access in a frame to a resident treelet
+        uint64_t misses         = 0;    // access to an evicted treelet
+        uint64_t evictions      = 0;
+        uint64_t resident_bytes = 0;
+        uint64_t total_bytes    = 0;
+        uint64_t num_treelets   = 0;
+    };
+
+public:
+
+    ooc_scene();
+   ~ooc_scene();
+
+    ooc_scene(ooc_scene const&) = delete;
+    ooc_scene& operator=(ooc_scene const&) = delete;
+
+    // Map cache file, budget_bytes == 0 disables eviction
+    bool open(std::string const& filename, size_t budget_bytes);
+    void close();
+
+    bool is_open() const;
+
+    bvh_ref ref() const;
+
+    aabb const& bbox() const;
+    aligned_vector<sg::obj_material> const& materials() const;
+
+    // Reset access tracking and evict down to the budget, call between frames
+    // when no render thread is active
+    void end_frame();
+
+    counters get_counters() const;
+
+private:
+
+    struct impl;
+    std::unique_ptr<impl> impl_;
+
+    // Called from the SIGSEGV handler
+    friend bool handle_ooc_fault(void* addr);
+
+};
+
+} // namespace visionaray
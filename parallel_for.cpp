@@ -0,0 +1,194 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helper threads
+//
+
+namespace
+{
+
+class helper_pool
+{
+public:
+
+   ~helper_pool()
+    {
+        stop();
+    }
+
+    void resize(unsigned num_threads)
+    {
+        stop();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_ = std::max(num_threads, 1u);
+        start_locked();
+    }
+
+    unsigned size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    bool run(size_t num_chunks, std::function<void(size_t)> const& chunk)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (busy_)
+        {
+            return false;
+        }
+
+        if (threads_.empty())
+        {
+            start_locked();
+        }
+
+        busy_       = true;
+        chunk_      = &chunk;
+        num_chunks_ = num_chunks;
+        next_       = 0;
+        remaining_  = num_chunks;
+
+        work_cond_.notify_all();
+
+        work(lock);
+
+        done_cond_.wait(lock, [this]() { return remaining_ == 0; });
+
+        chunk_ = nullptr;
+        busy_  = false;
+
+        return true;
+    }
+
+private:
+
+    std::mutex                          mutex_;
+    std::condition_variable             work_cond_;
+    std::condition_variable             done_cond_;
+    std::vector<std::thread>            threads_;
+
+    unsigned                            size_       = std::max(std::thread::hardware_concurrency(), 1u);
+    bool                                stopping_   = false;
+    bool                                busy_       = false;
+
+    // Current call, chunk_ is null between calls
+    std::function<void(size_t)> const*  chunk_      = nullptr;
+    size_t                              num_chunks_ = 0;
+    size_t                              next_       = 0;
+    size_t                              remaining_  = 0;
+
+    void start_locked()
+    {
+        stopping_ = false;
+
+        for (unsigned i = 1; i < size_; ++i)
+        {
+            threads_.emplace_back([this]() { helper(); });
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+
+        work_cond_.notify_all();
+
+        for (auto& t : threads_)
+        {
+            t.join();
+        }
+
+        threads_.clear();
+    }
+
+    // Claim chunks until none is left, chunks are coarse so claiming under
+    // the lock is cheap. chunk_ stays valid until the last one is done
+    void work(std::unique_lock<std::mutex>& lock)
+    {
+        while (chunk_ != nullptr && next_ < num_chunks_)
+        {
+            size_t i = next_++;
+            auto const* chunk = chunk_;
+
+            lock.unlock();
+            (*chunk)(i);
+            lock.lock();
+
+            if (--remaining_ == 0)
+            {
+                done_cond_.notify_all();
+            }
+        }
+    }
+
+    void helper()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        for (;;)
+        {
+            work_cond_.wait(lock, [this]() { return stopping_ || (chunk_ != nullptr && next_ < num_chunks_); });
+
+            if (stopping_)
+            {
+                return;
+            }
+
+            work(lock);
+        }
+    }
+};
+
+helper_pool& get_pool()
+{
+    static helper_pool pool;
+    return pool;
+}
+
+} // namespace
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+void set_parallel_for_threads(unsigned num_threads)
+{
+    get_pool().resize(num_threads);
+}
+
+unsigned parallel_for_threads()
+{
+    return get_pool().size();
+}
+
+namespace detail
+{
+
+bool run_on_helpers(size_t num_chunks, std::function<void(size_t)> const& chunk)
+{
+    return get_pool().run(num_chunks, chunk);
+}
+
+} // namespace detail
+
+} // namespace visionaray
@@ -0,0 +1,79 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helper threads shared by all parallel_for() calls. They are started once
+// (num_threads - 1 of them, the calling thread does its share) and sleep
+// between calls. Set the count before the first parallel_for() runs, e.g. to
+// the number of render threads; it defaults to the hardware concurrency
+//
+
+void set_parallel_for_threads(unsigned num_threads);
+
+unsigned parallel_for_threads();
+
+namespace detail
+{
+
+// Call chunk(i) for i in [0, num_chunks) on the helper threads and the
+// calling thread. Returns false (nothing called) if the helpers are busy,
+// e.g. with a concurrent or nested call
+bool run_on_helpers(size_t num_chunks, std::function<void(size_t)> const& chunk);
+
+} // namespace detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Split [begin, end) into contiguous chunks of at least grain elements and
+// call func(first, last) for each chunk on the helper threads. Small ranges,
+// and calls made while the helpers are busy, run on the calling thread.
+// num_threads == 0 uses all helper threads
+//
+
+template <typename Func>
+void parallel_for(size_t begin, size_t end, size_t grain, Func func, unsigned num_threads = 0)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    if (num_threads == 0)
+    {
+        num_threads = parallel_for_threads();
+    }
+
+    size_t count = end - begin;
+    size_t num_chunks = std::min<size_t>(num_threads, count / std::max<size_t>(grain, 1));
+
+    if (num_chunks <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    size_t chunk = count / num_chunks;
+    size_t rest  = count % num_chunks;
+
+    auto run_chunk = [&](size_t i)
+    {
+        size_t first = begin + i * chunk + std::min(i, rest);
+        size_t last  = first + chunk + (i < rest ? 1 : 0);
+        func(first, last);
+    };
+
+    if (!detail::run_on_helpers(num_chunks, run_chunk))
+    {
+        func(begin, end);
+    }
+}
+
+} // namespace visionaray
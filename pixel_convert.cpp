@@ -0,0 +1,788 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// The SIMD kernels are compiled for their instruction set with target
+// attributes, independent of the compiler flags, and chosen at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VSNRAY_CONVERT_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2  __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+#include "parallel_for.h"
+#include "pixel_convert.h"
+
+namespace visionaray
+{
+
+// Pixels per thread at least
+static constexpr size_t grain = 1 << 16;
+
+using kernel_func = void (*)(void* dst, void const* src, size_t count);
+
+
+//-------------------------------------------------------------------------------------------------
+// Scalar kernels
+//
+
+static uint8_t float_to_unorm8(float f)
+{
+    // Same clamping as _mm_max_ps/_mm_min_ps, NaN becomes 0
+    f = f > 0.0f ? f : 0.0f;
+    f = f < 1.0f ? f : 1.0f;
+    return static_cast<uint8_t>(f * 255.0f + 0.5f);
+}
+
+static uint8_t unorm16_to_unorm8(uint16_t x)
+{
+    // round(x / 257)
+    return static_cast<uint8_t>((((x * 0xFF01u) >> 16) + 0x80u) >> 8);
+}
+
+static void scalar_r8_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = s[i];
+        d[i * 4 + 1] = s[i];
+        d[i * 4 + 2] = s[i];
+        d[i * 4 + 3] = 255;
+    }
+}
+
+static void scalar_rgb8_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = s[i * 3];
+        d[i * 4 + 1] = s[i * 3 + 1];
+        d[i * 4 + 2] = s[i * 3 + 2];
+        d[i * 4 + 3] = 255;
+    }
+}
+
+static void scalar_rgba8_to_rgb8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 3]     = s[i * 4];
+        d[i * 3 + 1] = s[i * 4 + 1];
+        d[i * 3 + 2] = s[i * 4 + 2];
+    }
+}
+
+static void scalar_rgb16_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint16_t const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = unorm16_to_unorm8(s[i * 3]);
+        d[i * 4 + 1] = unorm16_to_unorm8(s[i * 3 + 1]);
+        d[i * 4 + 2] = unorm16_to_unorm8(s[i * 3 + 2]);
+        d[i * 4 + 3] = 255;
+    }
+}
+
+static void scalar_rgba16_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint16_t const*>(src);
+
+    for (size_t i = 0; i < count * 4; ++i)
+    {
+        d[i] = unorm16_to_unorm8(s[i]);
+    }
+}
+
+static void scalar_rgb32f_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = float_to_unorm8(s[i * 3]);
+        d[i * 4 + 1] = float_to_unorm8(s[i * 3 + 1]);
+        d[i * 4 + 2] = float_to_unorm8(s[i * 3 + 2]);
+        d[i * 4 + 3] = 255;
+    }
+}
+
+static void scalar_rgba32f_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    for (size_t i = 0; i < count * 4; ++i)
+    {
+        d[i] = float_to_unorm8(s[i]);
+    }
+}
+
+static void scalar_rgb8_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = s[i * 3] / 255.0f;
+        d[i * 4 + 1] = s[i * 3 + 1] / 255.0f;
+        d[i * 4 + 2] = s[i * 3 + 2] / 255.0f;
+        d[i * 4 + 3] = 1.0f;
+    }
+}
+
+static void scalar_rgba8_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    for (size_t i = 0; i < count * 4; ++i)
+    {
+        d[i] = s[i] / 255.0f;
+    }
+}
+
+static void scalar_rgb32f_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = s[i * 3];
+        d[i * 4 + 1] = s[i * 3 + 1];
+        d[i * 4 + 2] = s[i * 3 + 2];
+        d[i * 4 + 3] = 1.0f;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// SIMD kernels, the remainder of each is converted by the scalar kernel
+//
+
+#if defined(VSNRAY_CONVERT_X86)
+
+TARGET_SSE2 static __m128i load(void const* ptr)
+{
+    return _mm_loadu_si128(static_cast<__m128i const*>(ptr));
+}
+
+TARGET_SSE2 static void store(void* ptr, __m128i v)
+{
+    _mm_storeu_si128(static_cast<__m128i*>(ptr), v);
+}
+
+TARGET_SSE2 static __m128i alpha_one()
+{
+    return _mm_set1_epi32(static_cast<int>(0xFF000000));
+}
+
+// Eight 16-bit values to round(x / 257)
+TARGET_SSE2 static __m128i unorm16_to_unorm8(__m128i x)
+{
+    __m128i hi = _mm_mulhi_epu16(x, _mm_set1_epi16(static_cast<short>(0xFF01)));
+    return _mm_srli_epi16(_mm_add_epi16(hi, _mm_set1_epi16(0x80)), 8);
+}
+
+// Four floats to 32-bit unorm8 values
+TARGET_SSE2 static __m128i float_to_unorm8(__m128 f)
+{
+    f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+// 16 floats to 16 unorm8 values
+TARGET_SSE2 static __m128i float_to_unorm8(float const* s)
+{
+    __m128i i0 = float_to_unorm8(_mm_loadu_ps(s));
+    __m128i i1 = float_to_unorm8(_mm_loadu_ps(s + 4));
+    __m128i i2 = float_to_unorm8(_mm_loadu_ps(s + 8));
+    __m128i i3 = float_to_unorm8(_mm_loadu_ps(s + 12));
+    return _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+}
+
+TARGET_SSE2 static void simd_r8_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i r  = load(s + i);
+        __m128i lo = _mm_unpacklo_epi8(r, r);
+        __m128i hi = _mm_unpackhi_epi8(r, r);
+
+        store(d + i * 4,      _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha_one()));
+        store(d + i * 4 + 16, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha_one()));
+        store(d + i * 4 + 32, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha_one()));
+        store(d + i * 4 + 48, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha_one()));
+    }
+
+    scalar_r8_to_rgba8(d + i * 4, s + i, count - i);
+}
+
+TARGET_SSE2 static void simd_rgba16_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint16_t const*>(src);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i lo = unorm16_to_unorm8(load(s + i * 4));
+        __m128i hi = unorm16_to_unorm8(load(s + i * 4 + 8));
+        store(d + i * 4, _mm_packus_epi16(lo, hi));
+    }
+
+    scalar_rgba16_to_rgba8(d + i * 4, s + i * 4, count - i);
+}
+
+TARGET_SSE2 static void simd_rgba32f_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        store(d + i * 4, float_to_unorm8(s + i * 4));
+    }
+
+    scalar_rgba32f_to_rgba8(d + i * 4, s + i * 4, count - i);
+}
+
+TARGET_SSE2 static void simd_rgba8_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    __m128i zero = _mm_setzero_si128();
+    __m128  norm = _mm_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i c  = load(s + i * 4);
+        __m128i lo = _mm_unpacklo_epi8(c, zero);
+        __m128i hi = _mm_unpackhi_epi8(c, zero);
+
+        float* p = d + i * 4;
+        _mm_storeu_ps(p,      _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), norm));
+        _mm_storeu_ps(p + 4,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), norm));
+        _mm_storeu_ps(p + 8,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), norm));
+        _mm_storeu_ps(p + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), norm));
+    }
+
+    scalar_rgba8_to_rgba32f(d + i * 4, s + i * 4, count - i);
+}
+
+TARGET_SSE2 static void simd_rgb32f_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 w   = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // The last pixel is not loaded with four floats to not read past the end
+    size_t i = 0;
+    for (; i + 1 < count; ++i)
+    {
+        __m128 c = _mm_loadu_ps(s + i * 3);
+        _mm_storeu_ps(d + i * 4, _mm_or_ps(_mm_and_ps(c, xyz), w));
+    }
+
+    scalar_rgb32f_to_rgba32f(d + i * 4, s + i * 3, count - i);
+}
+
+
+
+// 16 RGB8 pixels in 48 bytes to RGBA8
+TARGET_SSSE3 static void store_rgb8_as_rgba8(uint8_t* d, __m128i a, __m128i b, __m128i c)
+{
+    __m128i mask = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+
+    store(d,      _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha_one()));
+    store(d + 16, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha_one()));
+    store(d + 32, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha_one()));
+    store(d + 48, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha_one()));
+}
+
+TARGET_SSSE3 static void simd_rgb8_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        store_rgb8_as_rgba8(d + i * 4, load(s + i * 3), load(s + i * 3 + 16), load(s + i * 3 + 32));
+    }
+
+    scalar_rgb8_to_rgba8(d + i * 4, s + i * 3, count - i);
+}
+
+TARGET_SSSE3 static void simd_rgba8_to_rgb8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        // Four times 12 packed bytes
+        __m128i p0 = _mm_shuffle_epi8(load(s + i * 4),      mask);
+        __m128i p1 = _mm_shuffle_epi8(load(s + i * 4 + 16), mask);
+        __m128i p2 = _mm_shuffle_epi8(load(s + i * 4 + 32), mask);
+        __m128i p3 = _mm_shuffle_epi8(load(s + i * 4 + 48), mask);
+
+        store(d + i * 3,      _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+        store(d + i * 3 + 16, _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+        store(d + i * 3 + 32, _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+    }
+
+    scalar_rgba8_to_rgb8(d + i * 3, s + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void simd_rgb16_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<uint16_t const*>(src);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint16_t const* p = s + i * 3;
+
+        __m128i a = _mm_packus_epi16(unorm16_to_unorm8(load(p)),      unorm16_to_unorm8(load(p + 8)));
+        __m128i b = _mm_packus_epi16(unorm16_to_unorm8(load(p + 16)), unorm16_to_unorm8(load(p + 24)));
+        __m128i c = _mm_packus_epi16(unorm16_to_unorm8(load(p + 32)), unorm16_to_unorm8(load(p + 40)));
+
+        store_rgb8_as_rgba8(d + i * 4, a, b, c);
+    }
+
+    scalar_rgb16_to_rgba8(d + i * 4, s + i * 3, count - i);
+}
+
+TARGET_SSSE3 static void simd_rgb32f_to_rgba8(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<float const*>(src);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        float const* p = s + i * 3;
+        store_rgb8_as_rgba8(d + i * 4, float_to_unorm8(p), float_to_unorm8(p + 16), float_to_unorm8(p + 32));
+    }
+
+    scalar_rgb32f_to_rgba8(d + i * 4, s + i * 3, count - i);
+}
+
+TARGET_SSSE3 static void simd_rgb8_to_rgba32f(void* dst, void const* src, size_t count)
+{
+    auto d = static_cast<float*>(dst);
+    auto s = static_cast<uint8_t const*>(src);
+
+    // Expand to RGBA8 in blocks that stay in L1
+    uint8_t rgba[256 * 4];
+
+    for (size_t i = 0; i < count; i += 256)
+    {
+        size_t n = std::min<size_t>(256, count - i);
+        simd_rgb8_to_rgba8(rgba, s + i * 3, n);
+        simd_rgba8_to_rgba32f(d + i * 4, rgba, n);
+    }
+}
+
+#endif // VSNRAY_CONVERT_X86
+
+
+//-------------------------------------------------------------------------------------------------
+// sRGB
+//
+
+// 0..255: sRGB to linear, 256..511: unorm8 to float (alpha)
+static float const* srgb_decode_table()
+{
+    static float const* table = []()
+    {
+        static float t[512];
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            t[i + 256] = c;
+        }
+        return t;
+    }();
+
+    return table;
+}
+
+static void scalar_decode_srgb(float* d, uint8_t const* s, size_t count)
+{
+    float const* table = srgb_decode_table();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = table[s[i * 4]];
+        d[i * 4 + 1] = table[s[i * 4 + 1]];
+        d[i * 4 + 2] = table[s[i * 4 + 2]];
+        d[i * 4 + 3] = table[s[i * 4 + 3] + 256];
+    }
+}
+
+#if defined(VSNRAY_CONVERT_X86)
+
+TARGET_AVX2 static void simd_decode_srgb(float* d, uint8_t const* s, size_t count)
+{
+    float const* table = srgb_decode_table();
+    __m256i alpha = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i c = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(s + i * 4));
+        __m256i index = _mm256_add_epi32(_mm256_cvtepu8_epi32(c), alpha);
+        _mm256_storeu_ps(d + i * 4, _mm256_i32gather_ps(table, index, 4));
+    }
+
+    scalar_decode_srgb(d + i * 4, s + i * 4, count - i);
+}
+
+#endif // VSNRAY_CONVERT_X86
+
+static uint8_t linear_to_srgb(float c)
+{
+    c = c > 0.0f ? c : 0.0f;
+    c = c < 1.0f ? c : 1.0f;
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(c * 255.0f + 0.5f);
+}
+
+static void scalar_encode_srgb(uint8_t* d, float const* s, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        d[i * 4]     = linear_to_srgb(s[i * 4]);
+        d[i * 4 + 1] = linear_to_srgb(s[i * 4 + 1]);
+        d[i * 4 + 2] = linear_to_srgb(s[i * 4 + 2]);
+        d[i * 4 + 3] = float_to_unorm8(s[i * 4 + 3]);
+    }
+}
+
+#if defined(VSNRAY_CONVERT_X86)
+
+// c^(1/2.4) for c in [0.0031308, 1], as exp2(log2(c) / 2.4). Least squares
+// polynomials for log2 on [1,2) and exp2 on [0,1), max. relative error ~1e-5
+TARGET_SSE2 static __m128 pow_1_over_2_4(__m128 c)
+{
+    __m128i bits = _mm_castps_si128(c);
+    __m128  e    = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128  m    = _mm_castsi128_ps(_mm_or_si128(
+            _mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+            _mm_set1_epi32(0x3F800000)
+            ));
+
+    __m128 t = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+    __m128 l = _mm_set1_ps(0.043928627f);
+    l = _mm_add_ps(_mm_mul_ps(l, t), _mm_set1_ps(-0.18983245f));
+    l = _mm_add_ps(_mm_mul_ps(l, t), _mm_set1_ps(0.41156148f));
+    l = _mm_add_ps(_mm_mul_ps(l, t), _mm_set1_ps(-0.70725343f));
+    l = _mm_add_ps(_mm_mul_ps(l, t), _mm_set1_ps(1.4415921f));
+    l = _mm_add_ps(_mm_mul_ps(l, t), _mm_set1_ps(1.4390931e-5f));
+
+    __m128 y = _mm_mul_ps(_mm_add_ps(e, l), _mm_set1_ps(1.0f / 2.4f));
+
+    // floor(y), y <= 0
+    __m128i yi = _mm_cvttps_epi32(y);
+    yi = _mm_add_epi32(yi, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(yi), y)));
+    __m128 f = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+
+    __m128 p = _mm_set1_ps(0.013683983f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.051717735f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.24162132f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.69296955f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0000036f));
+
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(yi, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+}
+
+// One RGBA pixel
+TARGET_SSE2 static __m128i encode_srgb(__m128 c)
+{
+    c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+    __m128 threshold = _mm_set1_ps(0.0031308f);
+    __m128 lin = _mm_mul_ps(c, _mm_set1_ps(12.92f));
+    __m128 pw  = _mm_sub_ps(
+            _mm_mul_ps(_mm_set1_ps(1.055f), pow_1_over_2_4(_mm_max_ps(c, threshold))),
+            _mm_set1_ps(0.055f)
+            );
+
+    __m128 use_lin = _mm_cmple_ps(c, threshold);
+    __m128 s = _mm_or_ps(_mm_and_ps(use_lin, lin), _mm_andnot_ps(use_lin, pw));
+
+    // Alpha is linear
+    __m128 alpha = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    s = _mm_or_ps(_mm_and_ps(alpha, c), _mm_andnot_ps(alpha, s));
+
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+TARGET_SSE2 static void simd_encode_srgb(uint8_t* d, float const* s, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i i0 = encode_srgb(_mm_loadu_ps(s + i * 4));
+        __m128i i1 = encode_srgb(_mm_loadu_ps(s + i * 4 + 4));
+        __m128i i2 = encode_srgb(_mm_loadu_ps(s + i * 4 + 8));
+        __m128i i3 = encode_srgb(_mm_loadu_ps(s + i * 4 + 12));
+        store(d + i * 4, _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3)));
+    }
+
+    scalar_encode_srgb(d + i * 4, s + i * 4, count - i);
+}
+
+#endif // VSNRAY_CONVERT_X86
+
+
+//-------------------------------------------------------------------------------------------------
+// Conversion table
+//
+
+struct conversion
+{
+    pixel_format    dst_format;
+    pixel_format    src_format;
+    size_t          dst_size;       // bytes per pixel
+    size_t          src_size;
+    kernel_func     scalar;
+    kernel_func     sse2;           // scalar if there is no SSE2 kernel
+    kernel_func     ssse3;
+};
+
+#if defined(VSNRAY_CONVERT_X86)
+#define SIMD_KERNELS(SSE2, SSSE3) SSE2, SSSE3
+#else
+#define SIMD_KERNELS(SSE2, SSSE3) nullptr, nullptr
+#endif
+
+static conversion const conversions[] = {
+    { PF_RGBA8,   PF_R8,       4,  1, scalar_r8_to_rgba8,       SIMD_KERNELS(simd_r8_to_rgba8,         simd_r8_to_rgba8)       },
+    { PF_RGBA8,   PF_RGB8,     4,  3, scalar_rgb8_to_rgba8,     SIMD_KERNELS(scalar_rgb8_to_rgba8,     simd_rgb8_to_rgba8)     },
+    { PF_RGBA8,   PF_RGB16UI,  4,  6, scalar_rgb16_to_rgba8,    SIMD_KERNELS(scalar_rgb16_to_rgba8,    simd_rgb16_to_rgba8)    },
+    { PF_RGBA8,   PF_RGBA16UI, 4,  8, scalar_rgba16_to_rgba8,   SIMD_KERNELS(simd_rgba16_to_rgba8,     simd_rgba16_to_rgba8)   },
+    { PF_RGBA8,   PF_RGB32F,   4, 12, scalar_rgb32f_to_rgba8,   SIMD_KERNELS(scalar_rgb32f_to_rgba8,   simd_rgb32f_to_rgba8)   },
+    { PF_RGBA8,   PF_RGBA32F,  4, 16, scalar_rgba32f_to_rgba8,  SIMD_KERNELS(simd_rgba32f_to_rgba8,    simd_rgba32f_to_rgba8)  },
+    { PF_RGBA32F, PF_RGB8,    16,  3, scalar_rgb8_to_rgba32f,   SIMD_KERNELS(scalar_rgb8_to_rgba32f,   simd_rgb8_to_rgba32f)   },
+    { PF_RGBA32F, PF_RGBA8,   16,  4, scalar_rgba8_to_rgba32f,  SIMD_KERNELS(simd_rgba8_to_rgba32f,    simd_rgba8_to_rgba32f)  },
+    { PF_RGBA32F, PF_RGB32F,  16, 12, scalar_rgb32f_to_rgba32f, SIMD_KERNELS(simd_rgb32f_to_rgba32f,   simd_rgb32f_to_rgba32f) },
+    { PF_RGB8,    PF_RGBA8,    3,  4, scalar_rgba8_to_rgb8,     SIMD_KERNELS(scalar_rgba8_to_rgb8,     simd_rgba8_to_rgb8)     },
+};
+
+#undef SIMD_KERNELS
+
+static conversion const* find_conversion(pixel_format dst_format, pixel_format src_format)
+{
+    for (auto const& c : conversions)
+    {
+        if (c.dst_format == dst_format && c.src_format == src_format)
+        {
+            return &c;
+        }
+    }
+
+    return nullptr;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Runtime dispatch
+//
+
+enum isa_level
+{
+    ScalarISA,
+    SSE2ISA,
+    SSSE3ISA,
+    AVX2ISA
+};
+
+static isa_level detect_isa()
+{
+#if defined(VSNRAY_CONVERT_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2ISA;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        return SSSE3ISA;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        return SSE2ISA;
+    }
+#endif
+
+    return ScalarISA;
+}
+
+static isa_level runtime_isa()
+{
+    static isa_level const isa = detect_isa();
+    return isa;
+}
+
+static kernel_func select_kernel(conversion const& c, conversion_kernel kernel)
+{
+    if (kernel == SIMDKernel && runtime_isa() >= SSSE3ISA)
+    {
+        return c.ssse3;
+    }
+    else if (kernel == SIMDKernel && runtime_isa() >= SSE2ISA)
+    {
+        return c.sse2;
+    }
+
+    return c.scalar;
+}
+
+using decode_func = void (*)(float* d, uint8_t const* s, size_t count);
+using encode_func = void (*)(uint8_t* d, float const* s, size_t count);
+
+static decode_func select_decode(conversion_kernel kernel)
+{
+#if defined(VSNRAY_CONVERT_X86)
+    if (kernel == SIMDKernel && runtime_isa() >= AVX2ISA)
+    {
+        return simd_decode_srgb;
+    }
+#endif
+
+    return scalar_decode_srgb;
+}
+
+static encode_func select_encode(conversion_kernel kernel)
+{
+#if defined(VSNRAY_CONVERT_X86)
+    if (kernel == SIMDKernel && runtime_isa() >= SSE2ISA)
+    {
+        return simd_encode_srgb;
+    }
+#endif
+
+    return scalar_encode_srgb;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+char const* conversion_isa()
+{
+    switch (runtime_isa())
+    {
+    case AVX2ISA:
+        return "AVX2";
+    case SSSE3ISA:
+        return "SSSE3";
+    case SSE2ISA:
+        return "SSE2";
+    default:
+        return "none";
+    }
+}
+
+bool can_convert_pixels(pixel_format dst_format, pixel_format src_format)
+{
+    return find_conversion(dst_format, src_format) != nullptr;
+}
+
+bool convert_pixels(
+        void*               dst,
+        pixel_format        dst_format,
+        void const*         src,
+        pixel_format        src_format,
+        size_t              count,
+        conversion_kernel   kernel,
+        unsigned            num_threads
+        )
+{
+    auto c = find_conversion(dst_format, src_format);
+
+    if (c == nullptr)
+    {
+        return false;
+    }
+
+    kernel_func func = select_kernel(*c, kernel);
+
+    parallel_for(0, count, grain, [&](size_t first, size_t last)
+    {
+        func(
+            static_cast<uint8_t*>(dst) + first * c->dst_size,
+            static_cast<uint8_t const*>(src) + first * c->src_size,
+            last - first
+            );
+    },
+    num_threads);
+
+    return true;
+}
+
+void decode_srgb(float* dst, uint8_t const* src, size_t count, conversion_kernel kernel, unsigned num_threads)
+{
+    decode_func func = select_decode(kernel);
+
+    parallel_for(0, count, grain, [&](size_t first, size_t last)
+    {
+        func(dst + first * 4, src + first * 4, last - first);
+    },
+    num_threads);
+}
+
+void encode_srgb(uint8_t* dst, float const* src, size_t count, conversion_kernel kernel, unsigned num_threads)
+{
+    encode_func func = select_encode(kernel);
+
+    parallel_for(0, count, grain, [&](size_t first, size_t last)
+    {
+        func(dst + first * 4, src + first * 4, last - first);
+    },
+    num_threads);
+}
+
+} // namespace visionaray
@@ -0,0 +1,73 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <visionaray/pixel_format.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Bulk pixel format conversion
+//
+// Conversions used by make_texture_rgba8 and the PNG output path:
+//
+//  R8, RGB8, RGB16UI, RGBA16UI, RGB32F, RGBA32F    -> RGBA8
+//  RGB8, RGBA8, RGB32F                             -> RGBA32F
+//  RGBA8                                           -> RGB8
+//
+// Conversions to RGBA from formats without alpha set alpha to one, R8 is
+// replicated to RGB. Floats are clamped to [0,1] and rounded, 16-bit values
+// are rounded to 8 bits. The SIMD kernels use SSE2/SSSE3 (or AVX2 for sRGB
+// decoding), chosen at runtime from what the CPU supports, and produce the
+// same results as the scalar kernels, except for encode_srgb (see below).
+// Large conversions are split across the parallel_for() helper threads
+// (num_threads == 0 uses all of them)
+//
+
+enum conversion_kernel
+{
+    ScalarKernel,
+    SIMDKernel
+};
+
+// Name of the instruction set the SIMD kernels use on this CPU
+char const* conversion_isa();
+
+bool can_convert_pixels(pixel_format dst_format, pixel_format src_format);
+
+// Returns false if the conversion is not supported
+bool convert_pixels(
+        void*               dst,
+        pixel_format        dst_format,
+        void const*         src,
+        pixel_format        src_format,
+        size_t              count,
+        conversion_kernel   kernel      = SIMDKernel,
+        unsigned            num_threads = 0
+        );
+
+// RGBA8 with sRGB encoded RGB to linear RGBA32F (table lookup)
+void decode_srgb(
+        float*              dst,
+        uint8_t const*      src,
+        size_t              count,
+        conversion_kernel   kernel      = SIMDKernel,
+        unsigned            num_threads = 0
+        );
+
+// Linear RGBA32F to RGBA8 with sRGB encoded RGB. The SIMD kernel evaluates
+// the transfer function with polynomial log2/exp2 approximations and may be
+// off by one from the scalar kernel (std::pow) for a few inputs
+void encode_srgb(
+        uint8_t*            dst,
+        float const*        src,
+        size_t              count,
+        conversion_kernel   kernel      = SIMDKernel,
+        unsigned            num_threads = 0
+        );
+
+} // namespace visionaray
@@ -0,0 +1,223 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <common/timer.h>
+
+#include "pixel_convert.h"
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Benchmark of the pixel conversion kernels
+//
+// Usage: pixel_convert_bench [megapixels] [repetitions]
+//
+// Every conversion is run with the scalar kernel on one thread, the SIMD
+// kernel on one thread and the SIMD kernel on all threads. The SIMD results
+// are compared against the scalar results
+//
+
+struct format_info
+{
+    pixel_format    format;
+    char const*     name;
+    size_t          size;       // bytes per pixel
+    bool            is_float;
+};
+
+static format_info const formats[] = {
+    { PF_R8,       "R8",        1, false },
+    { PF_RGB8,     "RGB8",      3, false },
+    { PF_RGBA8,    "RGBA8",     4, false },
+    { PF_RGB16UI,  "RGB16UI",   6, false },
+    { PF_RGBA16UI, "RGBA16UI",  8, false },
+    { PF_RGB32F,   "RGB32F",   12, true  },
+    { PF_RGBA32F,  "RGBA32F",  16, true  }
+};
+
+static void fill_random(std::vector<uint8_t>& data, format_info const& info)
+{
+    std::mt19937 rng(1);
+
+    if (info.is_float)
+    {
+        // Slightly outside [0,1] to exercise clamping
+        std::uniform_real_distribution<float> dist(-0.1f, 1.1f);
+        auto f = reinterpret_cast<float*>(data.data());
+        std::generate(f, f + data.size() / sizeof(float), [&]() { return dist(rng); });
+    }
+    else
+    {
+        std::uniform_int_distribution<int> dist(0, 255);
+        std::generate(data.begin(), data.end(), [&]() { return static_cast<uint8_t>(dist(rng)); });
+    }
+}
+
+// Max. difference of two results, in units of the destination format
+static double max_difference(std::vector<uint8_t> const& a, std::vector<uint8_t> const& b, bool is_float)
+{
+    double result = 0.0;
+
+    if (is_float)
+    {
+        auto fa = reinterpret_cast<float const*>(a.data());
+        auto fb = reinterpret_cast<float const*>(b.data());
+        for (size_t i = 0; i < a.size() / sizeof(float); ++i)
+        {
+            result = std::max(result, static_cast<double>(std::abs(fa[i] - fb[i])));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            result = std::max(result, static_cast<double>(std::abs(int(a[i]) - int(b[i]))));
+        }
+    }
+
+    return result;
+}
+
+template <typename Func>
+static double best_time(int repetitions, Func func)
+{
+    double result = 1e30;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        timer t;
+        func();
+        result = std::min(result, t.elapsed());
+    }
+
+    return result;
+}
+
+static void print_row(
+        std::string const&  name,
+        size_t              count,
+        double              scalar,
+        double              simd,
+        double              parallel,
+        double              difference
+        )
+{
+    double mpix = count / 1e6;
+
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << mpix / scalar
+              << std::setw(10) << mpix / simd
+              << std::setw(10) << mpix / parallel
+              << std::setw(9) << scalar / simd << 'x'
+              << std::setw(9) << scalar / parallel << 'x'
+              << std::setw(8) << std::defaultfloat << std::setprecision(3) << difference << '\n';
+}
+
+int main(int argc, char** argv)
+{
+    double megapixels = argc > 1 ? std::atof(argv[1]) : 16.0;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    size_t count = static_cast<size_t>(megapixels * 1e6);
+
+    if (count == 0 || repetitions <= 0)
+    {
+        std::cerr << "Usage: pixel_convert_bench [megapixels] [repetitions]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Pixels: " << count << ", SIMD: " << conversion_isa() << '\n';
+    std::cout << "Throughput in MPixel/s (best of " << repetitions << "), difference SIMD vs. scalar\n\n";
+    std::cout << std::left << std::setw(22) << "conversion" << std::right
+              << std::setw(10) << "scalar"
+              << std::setw(10) << "simd"
+              << std::setw(10) << "parallel"
+              << std::setw(10) << "simd"
+              << std::setw(10) << "parallel"
+              << std::setw(8) << "diff" << '\n';
+
+    for (auto const& src : formats)
+    {
+        for (auto const& dst : formats)
+        {
+            if (!can_convert_pixels(dst.format, src.format))
+            {
+                continue;
+            }
+
+            std::vector<uint8_t> in(count * src.size);
+            std::vector<uint8_t> ref(count * dst.size);
+            std::vector<uint8_t> out(count * dst.size);
+            fill_random(in, src);
+
+            double scalar = best_time(repetitions, [&]()
+            {
+                convert_pixels(ref.data(), dst.format, in.data(), src.format, count, ScalarKernel, 1);
+            });
+
+            double simd = best_time(repetitions, [&]()
+            {
+                convert_pixels(out.data(), dst.format, in.data(), src.format, count, SIMDKernel, 1);
+            });
+
+            double parallel = best_time(repetitions, [&]()
+            {
+                convert_pixels(out.data(), dst.format, in.data(), src.format, count, SIMDKernel, 0);
+            });
+
+            double difference = max_difference(ref, out, dst.is_float);
+
+            print_row(std::string(src.name) + " -> " + dst.name, count, scalar, simd, parallel, difference);
+        }
+    }
+
+
+    // sRGB
+
+    {
+        std::vector<uint8_t> in(count * 4);
+        std::vector<uint8_t> ref(count * 16);
+        std::vector<uint8_t> out(count * 16);
+        fill_random(in, formats[2]);
+
+        auto ref_ptr = reinterpret_cast<float*>(ref.data());
+        auto out_ptr = reinterpret_cast<float*>(out.data());
+
+        double scalar   = best_time(repetitions, [&]() { decode_srgb(ref_ptr, in.data(), count, ScalarKernel, 1); });
+        double simd     = best_time(repetitions, [&]() { decode_srgb(out_ptr, in.data(), count, SIMDKernel, 1); });
+        double parallel = best_time(repetitions, [&]() { decode_srgb(out_ptr, in.data(), count, SIMDKernel, 0); });
+
+        print_row("sRGB decode", count, scalar, simd, parallel, max_difference(ref, out, true));
+    }
+
+    {
+        std::vector<uint8_t> in(count * 16);
+        std::vector<uint8_t> ref(count * 4);
+        std::vector<uint8_t> out(count * 4);
+        fill_random(in, formats[6]);
+
+        auto in_ptr = reinterpret_cast<float const*>(in.data());
+
+        double scalar   = best_time(repetitions, [&]() { encode_srgb(ref.data(), in_ptr, count, ScalarKernel, 1); });
+        double simd     = best_time(repetitions, [&]() { encode_srgb(out.data(), in_ptr, count, SIMDKernel, 1); });
+        double parallel = best_time(repetitions, [&]() { encode_srgb(out.data(), in_ptr, count, SIMDKernel, 0); });
+
+        print_row("sRGB encode", count, scalar, simd, parallel, max_difference(ref, out, false));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+#include <queue>
+#include <vector>
+
+#include <visionaray/math/math.h>
+
+#include "presplit.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static float half_surface_area(aabb const& box)
+{
+    vec3 s = max(box.max - box.min, vec3(0.0f));
+    return s.x * s.y + s.y * s.z + s.z * s.x;
+}
+
+static bool is_empty(aabb const& box)
+{
+    return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+
+static int longest_axis(aabb const& box)
+{
+    vec3 s = box.max - box.min;
+    return s.x >= s.y && s.x >= s.z ? 0 : (s.y >= s.z ? 1 : 2);
+}
+
+struct split_candidate
+{
+    triangle_reference  ref;
+    float               priority;
+
+    bool operator<(split_candidate const& rhs) const
+    {
+        return priority < rhs.priority;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Greedily split the largest qualifying references at the middle of their
+// longest axis until they are no larger than an average triangle bbox or the
+// budget is exhausted
+//
+
+aligned_vector<triangle_reference> presplit_triangles(
+        model::triangle_type const* primitives,
+        size_t                      num_prims,
+        float                       max_duplication,
+        float                       min_ratio,
+        presplit_stats&             stats
+        )
+{
+    stats = presplit_stats();
+    stats.num_primitives = num_prims;
+
+    aligned_vector<triangle_reference> result;
+    result.reserve(static_cast<size_t>(std::max(max_duplication, 1.0f) * num_prims));
+
+    if (num_prims == 0)
+    {
+        return result;
+    }
+
+    double mean_half_area = 0.0;
+
+    for (size_t i = 0; i < num_prims; ++i)
+    {
+        result.push_back(make_reference(primitives[i], static_cast<unsigned>(i)));
+        mean_half_area += half_surface_area(result.back().bounds);
+    }
+
+    mean_half_area /= static_cast<double>(num_prims);
+
+    float target = static_cast<float>(mean_half_area);
+
+    // Move candidates from the result list to the queue
+    std::priority_queue<split_candidate> queue;
+
+    size_t num_kept = 0;
+
+    for (size_t i = 0; i < num_prims; ++i)
+    {
+        auto const& tri = primitives[i];
+        auto const& ref = result[i];
+
+        float area = 0.5f * length(cross(tri.e1, tri.e2));
+        float half_area = half_surface_area(ref.bounds);
+
+        // 2 * half_area / (4 * area), see gather_scene_statistics()
+        bool sliver = area > 0.0f && half_area / (2.0f * area) > min_ratio;
+
+        if (sliver && half_area > target)
+        {
+            queue.push({ ref, half_area });
+            ++stats.num_candidates;
+        }
+        else
+        {
+            result[num_kept++] = ref;
+        }
+    }
+
+    result.resize(num_kept);
+
+    auto budget = static_cast<size_t>(std::max(max_duplication - 1.0f, 0.0f) * num_prims);
+
+    while (budget > 0 && !queue.empty())
+    {
+        auto ref = queue.top().ref;
+        queue.pop();
+
+        int axis = longest_axis(ref.bounds);
+        float pos = (ref.bounds.min[axis] + ref.bounds.max[axis]) * 0.5f;
+
+        triangle_reference children[2];
+        split_reference(ref, primitives[ref.prim], axis, pos, children[0], children[1]);
+
+        // Numerically, clipping may leave one side empty
+        if (is_empty(children[0].bounds) || is_empty(children[1].bounds))
+        {
+            result.push_back(ref);
+            continue;
+        }
+
+        --budget;
+
+        for (auto const& child : children)
+        {
+            float half_area = half_surface_area(child.bounds);
+
+            if (half_area > target)
+            {
+                queue.push({ child, half_area });
+            }
+            else
+            {
+                result.push_back(child);
+            }
+        }
+    }
+
+    while (!queue.empty())
+    {
+        result.push_back(queue.top().ref);
+        queue.pop();
+    }
+
+    stats.num_references = result.size();
+
+    return result;
+}
+
+} // namespace visionaray
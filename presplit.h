@@ -0,0 +1,81 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <visionaray/aligned_vector.h>
+#include <visionaray/bvh.h>
+
+#include <common/model.h>
+
+#include "triangle_reference.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Early split clipping: subdivide large triangles with a poor bbox-to-area
+// ratio into several tightly bounded references before running a fast
+// (binned or LBVH) builder. A cheap alternative to the spatial split search
+//
+
+struct presplit_stats
+{
+    size_t num_primitives   = 0;
+    size_t num_candidates   = 0;    // triangles that qualified for splitting
+    size_t num_references   = 0;
+
+    float duplication() const
+    {
+        return num_primitives > 0 ? num_references / static_cast<float>(num_primitives) : 1.0f;
+    }
+};
+
+// max_duplication: maximum references / primitives
+// min_ratio: triangle bbox surface area / (4 * triangle area) above which a
+// triangle is considered for splitting (1.0 for axis-aligned right triangles)
+aligned_vector<triangle_reference> presplit_triangles(
+        model::triangle_type const* primitives,
+        size_t                      num_prims,
+        float                       max_duplication,
+        float                       min_ratio,
+        presplit_stats&             stats
+        );
+
+
+//-------------------------------------------------------------------------------------------------
+// Build a BVH over references with one of visionaray's builders and map the
+// leaves back to the original triangles
+//
+
+template <typename Builder>
+index_bvh<model::triangle_type> build_from_references(
+        Builder&                                    builder,
+        model::triangle_type const*                 primitives,
+        size_t                                      num_prims,
+        aligned_vector<triangle_reference> const&   refs
+        )
+{
+    auto ref_bvh = builder.build(
+            index_bvh<triangle_reference>{},
+            refs.data(),
+            refs.size()
+            );
+
+    aligned_vector<unsigned> indices(ref_bvh.indices().size());
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i] = refs[ref_bvh.indices()[i]].prim;
+    }
+
+    index_bvh<model::triangle_type> result(primitives, num_prims);
+    result.nodes() = std::move(ref_bvh.nodes());
+    result.indices() = std::move(indices);
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,108 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <common/image.h>
+
+#include "accum_file.h"
+#include "pixel_convert.h"
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Merge partial accumulation buffers written with -accum-out
+//
+// Usage: raytracer-merge output input...
+//
+// The inputs must have the same size and disjoint sample ranges. An output
+// file name ending in .png is written as the final image (like raytracer
+// -png), anything else as an accumulation buffer that can be merged again
+//
+
+static bool ends_with(std::string const& str, std::string const& suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool save_png(std::string const& filename, accum_info const& info, std::vector<vec4> const& accum)
+{
+    size_t count = accum.size();
+
+    std::vector<uint32_t> rgba(count);
+    convert_pixels(rgba.data(), PF_RGBA8, accum.data(), PF_RGBA32F, count);
+
+    // Rotate by 180 degrees, as raytracer does
+    std::reverse(rgba.begin(), rgba.end());
+
+    std::vector<uint8_t> rgb(count * 3);
+    convert_pixels(rgb.data(), PF_RGB8, rgba.data(), PF_RGBA8, count);
+
+    image img(
+        info.width,
+        info.height,
+        PF_RGB8,
+        rgb.data()
+        );
+
+    image::save_option opt;
+    return img.save(filename, {opt});
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: raytracer-merge output input...\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string output = argv[1];
+
+    std::vector<accum_info> infos(argc - 2);
+    std::vector<std::vector<vec4>> parts(argc - 2);
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!read_accum_file(argv[i], infos[i - 2], parts[i - 2]))
+        {
+            std::cerr << "Cannot read accumulation buffer: " << argv[i] << '\n';
+            return EXIT_FAILURE;
+        }
+
+        auto const& info = infos[i - 2];
+        std::cout << argv[i] << ": " << info.width << 'x' << info.height << ", samples "
+                  << info.sample_first << ".." << info.sample_first + info.sample_count << '\n';
+    }
+
+    accum_info merged_info;
+    std::vector<vec4> merged;
+    std::string error;
+
+    if (!merge_accum(infos, parts, merged_info, merged, error))
+    {
+        std::cerr << "Cannot merge: " << error << '\n';
+        return EXIT_FAILURE;
+    }
+
+    bool ok = ends_with(output, ".png") || ends_with(output, ".PNG")
+            ? save_png(output, merged_info, merged)
+            : write_accum_file(output, merged_info, merged.data());
+
+    if (!ok)
+    {
+        std::cerr << "Cannot write: " << output << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::cout << output << ": " << merged_info.sample_count << " samples\n";
+
+    return EXIT_SUCCESS;
+}
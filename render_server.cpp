@@ -0,0 +1,427 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "render_server.h"
+#include "socket_io.h"
+
+namespace visionaray
+{
+
+// Longer lines are not requests
+static constexpr size_t max_line_length = 64 * 1024;
+
+static constexpr size_t max_image_size = 16384;
+
+static constexpr size_t max_spp = 65536;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static bool parse_size(std::string const& str, size_t& value)
+{
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long v = std::strtoull(str.c_str(), &end, 10);
+
+    if (str.empty() || str[0] == '-' || *end != '\0' || errno != 0)
+    {
+        return false;
+    }
+
+    value = static_cast<size_t>(v);
+    return true;
+}
+
+static bool parse_vec3(std::string const& str, vec3& v)
+{
+    char tail = 0;
+    return std::sscanf(str.c_str(), "%f,%f,%f%c", &v.x, &v.y, &v.z, &tail) == 3;
+}
+
+// The socket is closed by the listener once the thread has been joined
+static void serve_connection(int fd, std::shared_ptr<render_queue> queue)
+{
+    std::string buffer;
+    std::string line;
+
+    while (recv_line(fd, buffer, line, max_line_length))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        auto job = std::make_shared<render_job>();
+        std::string error;
+        render_reply reply;
+
+        if (!parse_render_request(line, job->request, error))
+        {
+            reply = make_error_reply(error);
+        }
+        else
+        {
+            auto future = job->reply.get_future();
+
+            if (!queue->push(job))
+            {
+                reply = make_error_reply("server is shutting down");
+            }
+            else
+            {
+                try
+                {
+                    reply = future.get();
+                }
+                catch (std::exception const& e)
+                {
+                    reply = make_error_reply(e.what());
+                }
+            }
+        }
+
+        if (!send_all(fd, reply.header.data(), reply.header.size())
+         || !send_all(fd, reply.data.data(), reply.data.size()))
+        {
+            break;
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Protocol
+//
+
+bool parse_render_request(std::string const& line, render_request& request, std::string& error)
+{
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+
+    request = render_request{};
+
+    if (command == "quit")
+    {
+        request.quit = true;
+        return true;
+    }
+
+    if (command != "render")
+    {
+        error = "unknown command " + command;
+        return false;
+    }
+
+    int num_view = 0;
+    std::string token;
+
+    while (in >> token)
+    {
+        size_t eq = token.find('=');
+
+        if (eq == std::string::npos)
+        {
+            error = "expected key=value: " + token;
+            return false;
+        }
+
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+
+        bool ok = true;
+
+        if (key == "scene")
+        {
+            request.scene = value;
+        }
+        else if (key == "width")
+        {
+            ok = parse_size(value, request.width) && request.width > 0 && request.width <= max_image_size;
+        }
+        else if (key == "height")
+        {
+            ok = parse_size(value, request.height) && request.height > 0 && request.height <= max_image_size;
+        }
+        else if (key == "spp")
+        {
+            ok = parse_size(value, request.spp) && request.spp > 0 && request.spp <= max_spp;
+        }
+        else if (key == "eye")
+        {
+            ok = parse_vec3(value, request.view.eye);
+            ++num_view;
+        }
+        else if (key == "center")
+        {
+            ok = parse_vec3(value, request.view.center);
+            ++num_view;
+        }
+        else if (key == "up")
+        {
+            ok = parse_vec3(value, request.view.up);
+            ++num_view;
+        }
+        else if (key == "output")
+        {
+            if (value == "rgb")
+            {
+                request.output = RGBOutput;
+            }
+            else if (value.compare(0, 4, "png:") == 0 && value.size() > 4)
+            {
+                request.output = PNGOutput;
+                request.target = value.substr(4);
+            }
+            else if (value.compare(0, 4, "shm:") == 0 && value.size() > 4)
+            {
+                request.output = SHMOutput;
+                request.target = value.substr(4);
+            }
+            else
+            {
+                ok = false;
+            }
+        }
+        else
+        {
+            error = "unknown key " + key;
+            return false;
+        }
+
+        if (!ok)
+        {
+            error = "invalid value for " + key + ": " + value;
+            return false;
+        }
+    }
+
+    if (num_view != 0 && num_view != 3)
+    {
+        error = "eye, center and up must be given together";
+        return false;
+    }
+
+    request.has_view = num_view == 3;
+
+    return true;
+}
+
+render_reply make_error_reply(std::string const& message)
+{
+    std::string header = "error " + message;
+
+    // Keep the response a single line
+    std::replace(header.begin(), header.end(), '\n', ' ');
+
+    return { header + '\n', {} };
+}
+
+bool write_shm_image(std::string const& name, uint8_t const* data, size_t size)
+{
+    shm_unlink(name.c_str());
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    std::memcpy(ptr, data, size);
+    munmap(ptr, size);
+
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// render_queue
+//
+
+bool render_queue::push(std::shared_ptr<render_job> job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (closed_)
+        {
+            return false;
+        }
+
+        jobs_.push_back(std::move(job));
+    }
+
+    cond_.notify_one();
+    return true;
+}
+
+std::shared_ptr<render_job> render_queue::pop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    cond_.wait(lock, [this]() { return closed_ || !jobs_.empty(); });
+
+    if (jobs_.empty())
+    {
+        return nullptr;
+    }
+
+    auto job = std::move(jobs_.front());
+    jobs_.pop_front();
+    return job;
+}
+
+void render_queue::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+
+    cond_.notify_all();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// socket_listener
+//
+
+socket_listener::~socket_listener()
+{
+    close();
+}
+
+bool socket_listener::open(std::string const& path, std::shared_ptr<render_queue> queue)
+{
+    close();
+
+    fd_ = listen_socket(path);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    path_ = path;
+
+    thread_ = std::thread(&socket_listener::accept_loop, this, std::move(queue));
+
+    return true;
+}
+
+void socket_listener::close()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+
+    // Wakes up accept()
+    shutdown(fd_, SHUT_RDWR);
+
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+
+    join_connections(true);
+
+    ::close(fd_);
+    remove_socket_file(path_);
+
+    fd_ = -1;
+    path_.clear();
+}
+
+void socket_listener::accept_loop(std::shared_ptr<render_queue> queue)
+{
+    for (;;)
+    {
+        int conn = accept_socket(fd_);
+
+        if (conn < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (conn < 0)
+        {
+            // close() shut the socket down
+            break;
+        }
+
+        join_connections(false);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Connections wait for their replies independently
+        connections_.emplace_back();
+        auto& c = connections_.back();
+        c.fd = conn;
+        c.thread = std::thread([&c, conn, queue]()
+        {
+            serve_connection(conn, queue);
+            c.done = true;
+        });
+    }
+}
+
+void socket_listener::join_connections(bool all)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (all)
+    {
+        // Wakes up recv() and makes pending sends fail
+        for (auto& c : connections_)
+        {
+            shutdown(c.fd, SHUT_RDWR);
+        }
+    }
+
+    for (auto it = connections_.begin(); it != connections_.end(); )
+    {
+        if (!all && !it->done)
+        {
+            ++it;
+            continue;
+        }
+
+        it->thread.join();
+        ::close(it->fd);
+        it = connections_.erase(it);
+    }
+}
+
+} // namespace visionaray
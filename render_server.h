@@ -0,0 +1,200 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_path.h"
+#include "renderer.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Render server protocol
+//
+// One request per line. A response is one line, for rgb followed by the image:
+//
+//  render [scene=<obj>] [width=<w>] [height=<h>] [spp=<n>]
+//         [eye=<x,y,z> center=<x,y,z> up=<x,y,z>] [output=rgb|png:<path>|shm:<name>]
+//
+//      -> ok <w> <h> rgb <bytes>\n<bytes>      RGB8, top row first
+//      -> ok <w> <h> png <path>\n              written by the server
+//      -> ok <w> <h> shm <name> <bytes>\n      RGB8 in a new shared-memory
+//                                              segment, unlinked by the client
+//      -> error <message>\n
+//
+//  quit    -> ok\n, stops the server after the queued requests
+//
+// Omitted values default to the server's command line, the scene to the
+// positional file name, the camera to view-all. Paths must not contain spaces.
+// width and height are limited to 16384, spp to 65536. The socket is only
+// accessible by the user running the server
+//
+
+enum render_output
+{
+    RGBOutput,
+    PNGOutput,
+    SHMOutput
+};
+
+struct render_request
+{
+    bool            quit        = false;
+    std::string     scene;
+    size_t          width       = 0;
+    size_t          height      = 0;
+    size_t          spp         = 0;
+    bool            has_view    = false;
+    camera_view     view;
+    render_output   output      = RGBOutput;
+    std::string     target;
+};
+
+struct render_reply
+{
+    std::string             header;
+    std::vector<uint8_t>    data;
+};
+
+// false and a message for malformed requests
+bool parse_render_request(std::string const& line, render_request& request, std::string& error);
+
+render_reply make_error_reply(std::string const& message);
+
+// Copy size bytes to a new shared-memory segment, replacing one of the same name
+bool write_shm_image(std::string const& name, uint8_t const* data, size_t size);
+
+
+//-------------------------------------------------------------------------------------------------
+// Requests from all connections, rendered one at a time in arrival order
+//
+
+struct render_job
+{
+    render_request              request;
+    std::promise<render_reply>  reply;
+};
+
+class render_queue
+{
+public:
+
+    // false once the queue is closed
+    bool push(std::shared_ptr<render_job> job);
+
+    // Blocks until a job arrives, nullptr once the queue is closed and empty
+    std::shared_ptr<render_job> pop();
+
+    void close();
+
+private:
+
+    std::mutex                              mutex_;
+    std::condition_variable                 cond_;
+    std::deque<std::shared_ptr<render_job>> jobs_;
+    bool                                    closed_ = false;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Unix domain socket listener, one thread per connection feeds the queue.
+// Connection threads are owned by the listener: finished ones are joined when
+// the next connection arrives, close() shuts the remaining sockets down and
+// joins their threads
+//
+
+class socket_listener
+{
+public:
+
+    socket_listener() = default;
+   ~socket_listener();
+
+    socket_listener(socket_listener const&) = delete;
+    socket_listener& operator=(socket_listener const&) = delete;
+
+    // Replaces a stale socket file at path
+    bool open(std::string const& path, std::shared_ptr<render_queue> queue);
+    void close();
+
+private:
+
+    struct connection
+    {
+        int                 fd = -1;
+        std::thread         thread;
+        std::atomic<bool>   done { false };
+    };
+
+    std::string                     path_;
+    int                             fd_ = -1;
+    std::thread                     thread_;
+
+    std::mutex                      mutex_;
+    std::list<connection>           connections_;
+
+    void accept_loop(std::shared_ptr<render_queue> queue);
+
+    // Join and close finished connections, or all of them (after shutting
+    // their sockets down) if all is true
+    void join_connections(bool all);
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Render server, keeps up to max_scenes scenes resident in LRU order
+//
+
+template <typename Renderer>
+class render_server
+{
+public:
+
+    explicit render_server(Renderer& rend);
+
+    // Serves until a quit request, false if the socket or the initial scene
+    // cannot be opened
+    bool run(std::string const& socket_path, size_t max_scenes);
+
+private:
+
+    struct resident_scene
+    {
+        std::string filename;
+        scene_state state;
+    };
+
+    Renderer&                       rend_;
+    std::string                     default_scene_;
+    size_t                          default_width_;
+    size_t                          default_height_;
+    size_t                          default_spp_;
+    size_t                          max_scenes_ = 1;
+
+    // The active scene lives in the renderer, the others here, most recent first
+    std::string                     active_;
+    std::list<resident_scene>       scenes_;
+
+    bool activate(std::string const& filename);
+    render_reply render(render_request const& request);
+
+};
+
+} // namespace visionaray
+
+#include "render_server.inl"
@@ -0,0 +1,184 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include <common/timer.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// render_server
+//
+
+template <typename Renderer>
+render_server<Renderer>::render_server(Renderer& rend)
+    : rend_(rend)
+    , default_scene_(rend.filename)
+    , default_width_(rend.width)
+    , default_height_(rend.height)
+    , default_spp_(rend.spp)
+{
+}
+
+template <typename Renderer>
+bool render_server<Renderer>::run(std::string const& socket_path, size_t max_scenes)
+{
+    max_scenes_ = std::max<size_t>(max_scenes, 1);
+
+    std::cout << "Loading " << default_scene_ << "...\n";
+
+    if (!activate(default_scene_))
+    {
+        std::cerr << "Failed loading obj model\n";
+        return false;
+    }
+
+    auto queue = std::make_shared<render_queue>();
+
+    socket_listener listener;
+
+    if (!listener.open(socket_path, queue))
+    {
+        std::cerr << "Cannot listen on socket: " << socket_path << '\n';
+        return false;
+    }
+
+    std::cout << "Serving on " << socket_path << '\n';
+
+    while (auto job = queue->pop())
+    {
+        if (job->request.quit)
+        {
+            // Finish what is queued, refuse everything else
+            queue->close();
+            job->reply.set_value({ "ok\n", {} });
+            continue;
+        }
+
+        job->reply.set_value(render(job->request));
+    }
+
+    listener.close();
+
+    return true;
+}
+
+template <typename Renderer>
+bool render_server<Renderer>::activate(std::string const& filename)
+{
+    if (filename == active_)
+    {
+        return true;
+    }
+
+    if (!active_.empty())
+    {
+        scenes_.push_front({ active_, scene_state{} });
+        rend_.swap_scene(scenes_.front().state);
+        active_.clear();
+    }
+
+    auto it = std::find_if(scenes_.begin(), scenes_.end(), [&](resident_scene const& s)
+    {
+        return s.filename == filename;
+    });
+
+    if (it != scenes_.end())
+    {
+        rend_.swap_scene(it->state);
+        scenes_.erase(it);
+    }
+    else if (!rend_.load_scene(filename))
+    {
+        return false;
+    }
+
+    active_ = filename;
+
+    // The active scene counts, too
+    while (!scenes_.empty() && scenes_.size() + 1 > max_scenes_)
+    {
+        scenes_.pop_back();
+    }
+
+    return true;
+}
+
+template <typename Renderer>
+render_reply render_server<Renderer>::render(render_request const& request)
+{
+    timer t;
+
+    std::string scene = request.scene.empty() ? default_scene_ : request.scene;
+
+    if (!activate(scene))
+    {
+        return make_error_reply("cannot load scene " + scene);
+    }
+
+    size_t width  = request.width  ? request.width  : default_width_;
+    size_t height = request.height ? request.height : default_height_;
+    size_t spp    = request.spp    ? request.spp    : default_spp_;
+
+    if (width != rend_.width || height != rend_.height)
+    {
+        rend_.width  = width;
+        rend_.height = height;
+        rend_.resize(static_cast<int>(width), static_cast<int>(height));
+    }
+
+    if (request.has_view)
+    {
+        rend_.cam.look_at(request.view.eye, request.view.center, request.view.up);
+    }
+    else
+    {
+        rend_.cam.view_all(rend_.mod.bbox);
+    }
+
+    // Scene, BVH and render threads are kept, only accumulation restarts
+    rend_.clear_frame();
+
+    for (size_t sample = 0; sample < spp; ++sample)
+    {
+        rend_.render();
+    }
+
+    std::cout << "render " << scene << ' ' << width << 'x' << height << ", " << spp << " spp: "
+              << t.elapsed() << "ms\n";
+
+    std::string size = std::to_string(width) + ' ' + std::to_string(height);
+
+    if (request.output == PNGOutput)
+    {
+        if (!rend_.save_as_png(request.target))
+        {
+            return make_error_reply("cannot write " + request.target);
+        }
+
+        return { "ok " + size + " png " + request.target + '\n', {} };
+    }
+
+    auto rgb = rend_.color_rgb8();
+
+    if (request.output == SHMOutput)
+    {
+        if (!write_shm_image(request.target, rgb.data(), rgb.size()))
+        {
+            return make_error_reply("cannot create shared-memory segment " + request.target);
+        }
+
+        return { "ok " + size + " shm " + request.target + ' ' + std::to_string(rgb.size()) + '\n', {} };
+    }
+
+    std::string header = "ok " + size + " rgb " + std::to_string(rgb.size()) + '\n';
+
+    return { std::move(header), std::move(rgb) };
+}
+
+} // namespace visionaray
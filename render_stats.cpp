@@ -0,0 +1,67 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <iomanip>
+#include <ostream>
+
+#include "render_stats.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// render_stats
+//
+
+void render_stats::reset()
+{
+    path_queries    = 0;
+    path_ns         = 0;
+    compacted_lanes = 0;
+    shadow_queries  = 0;
+    shadow_nodes    = 0;
+    shadow_prims    = 0;
+    shadow_ns       = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Human readable report
+//
+
+void print_render_stats(std::ostream& out, render_stats const& stats)
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    uint64_t path_queries   = stats.path_queries;
+    uint64_t shadow_queries = stats.shadow_queries;
+    double path_ms   = stats.path_ns * 1e-6;
+    double shadow_ms = stats.shadow_ns * 1e-6;
+    double total_ms  = path_ms + shadow_ms;
+
+    out << std::fixed << std::setprecision(2);
+    out << "  closest hit: " << path_queries << " packets, " << path_ms << " ms";
+    if (total_ms > 0.0)
+    {
+        out << " (" << 100.0 * path_ms / total_ms << "%)";
+    }
+    out << ", " << stats.compacted_lanes << " lanes compacted\n";
+
+    out << "  shadow:      " << shadow_queries << " packets, " << shadow_ms << " ms";
+    if (total_ms > 0.0)
+    {
+        out << " (" << 100.0 * shadow_ms / total_ms << "%)";
+    }
+    if (shadow_queries > 0)
+    {
+        out << ", " << double(stats.shadow_nodes) / shadow_queries << " nodes/packet"
+            << ", " << double(stats.shadow_prims) / shadow_queries << " prims/packet";
+    }
+    out << '\n';
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace visionaray
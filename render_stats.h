@@ -0,0 +1,37 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Per-frame ray counts and traversal times, updated concurrently by the
+// render threads. Times are summed over all threads
+//
+
+struct render_stats
+{
+    // Closest-hit queries for camera and bounce rays
+    std::atomic<uint64_t> path_queries{0};
+    std::atomic<uint64_t> path_ns{0};
+
+    // Lanes finished as single rays after packet compaction
+    std::atomic<uint64_t> compacted_lanes{0};
+
+    // Any-hit queries for light visibility
+    std::atomic<uint64_t> shadow_queries{0};
+    std::atomic<uint64_t> shadow_nodes{0};
+    std::atomic<uint64_t> shadow_prims{0};
+    std::atomic<uint64_t> shadow_ns{0};
+
+    void reset();
+};
+
+void print_render_stats(std::ostream& out, render_stats const& stats);
+
+} // namespace visionaray
@@ -2,10 +2,12 @@
 // See the LICENSE file for details.
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <Support/CmdLine.h>
 
@@ -19,9 +21,37 @@
 
 #include <common/model.h>
 
+#include "build_strategy.h"
+#include "frame_stream.h"
+#include "huge_pages.h"
+#include "mip_texture.h"
+#include "ooc_scene.h"
+#include "presplit.h"
+#include "render_stats.h"
+#include "shading.h"
+#include "shm_render_target.h"
+#include "split_bvh_builder.h"
+#include "thread_affinity.h"
+#include "texture_cache.h"
+
 namespace visionaray
 {
 
+//-------------------------------------------------------------------------------------------------
+// Scene data that the render server keeps resident per scene
+//
+
+struct scene_state
+{
+    model                                       mod;
+    aligned_vector<plastic<float>>              materials;
+    material_bins                               binned_materials;
+    texture_set                                 textures;
+    index_bvh<model::triangle_type>             host_bvh;
+    std::vector<index_bvh<model::triangle_type>> bvh_replicas;
+};
+
+
 //-------------------------------------------------------------------------------------------------
 // struct with state variables
 //
@@ -31,31 +61,71 @@ struct renderer
 {
     using cmdline_option = std::shared_ptr<support::cl::OptionBase>;
 
-    enum bvh_build_strategy
-    {
-        Binned = 0, // Binned SAH builder, no spatial splits
-        Split,      // Split BVH, also binned and with SAH
-        LBVH,       // LBVH builder on the CPU
-    };
-
     pinhole_camera                              cam;
     simple_buffer_rt<PF_RGBA8, PF_UNSPECIFIED, PF_RGBA32F> host_rt;
+    shm_render_target                           shm_rt;
     tiled_sched<host_ray_type>                  host_sched;
     bvh_build_strategy                          build_strategy  = Binned;
+    affinity_policy                             affinity        = NoAffinity;
+    huge_page_mode                              huge_pages      = NoHugePages;
+    bool                                        show_bvh_stats  = false;
+    bool                                        show_render_stats = false;
+    bool                                        shm_accum       = false;
+    bool                                        dedup_groups    = false;
+    stream_format                               stream          = NoStream;
+    float                                       split_max_duplication = 2.0f;
+    float                                       split_alpha     = 1.0e-5f;
+    size_t                                      split_min_references = 8;
+    float                                       presplit_max_duplication = 1.0f;
+    float                                       presplit_min_ratio = 4.0f;
+    float                                       weld_epsilon    = 0.0f;
 
     std::string                                 filename;
     std::string                                 png_filename{"rendered_image.png"};
     std::string                                 initial_camera;
+    std::string                                 camera_path_filename;
+    std::string                                 bvh_stats_filename;
+    std::string                                 ooc_filename;
+    std::string                                 texture_cache_filename;
+    std::string                                 shm_name;
+    std::string                                 stream_filename{"-"};
+    std::string                                 serve_socket;
+    std::string                                 coordinator_address;
+    std::string                                 worker_address;
+    std::string                                 accum_filename;
 
     model                                       mod;
     aligned_vector<plastic<float>>              materials;
+    material_bins                               binned_materials;
+    texture_set                                 textures;
+    texture_cache                               tex_cache;
     index_bvh<model::triangle_type>             host_bvh;
+    std::vector<index_bvh<model::triangle_type>> bvh_replicas;  // per NUMA node, see replicate_bvh()
+    ooc_scene                                   ooc;
+    render_stats                                stats;
     unsigned                                    frame_num       = 0;
+    bool                                        fb_released     = false; // host_rt pages dropped, see resize()
+    recti                                       scissor_box{0, 0, 0, 0}; // empty = whole image
 
     size_t                                      width           = 512;
     size_t                                      height          = 512;
     size_t                                      num_threads     = 8;
     size_t                                      spp             = 8;
+    unsigned                                    bounces         = 4;
+    unsigned                                    rr_depth        = 3;
+    float                                       compact_threshold = 0.25f;
+    size_t                                      ooc_budget      = 4096;     // MB
+    size_t                                      ooc_treelet_prims = 16384;
+    size_t                                      texture_budget  = 2048;     // MB
+    unsigned                                    num_frames      = 1;
+    unsigned                                    fps             = 30;
+    size_t                                      serve_scenes    = 32;
+    size_t                                      min_workers     = 1;
+    size_t                                      tile_size       = 128;
+    size_t                                      tile_spp        = 0;
+    size_t                                      worker_timeout  = 60;
+    size_t                                      tile_timeout    = 600;
+    size_t                                      sample_first    = 0;
 
     std::vector<cmdline_option>                 options;
     support::cl::CmdLine                        cmd;
@@ -64,11 +134,49 @@ struct renderer
 
     void add_cmdline_option(cmdline_option option);
     void init(int argc, char** argv);
-    void save_as_png();
+    bool save_as_png(std::string const& filename);
+
+    // Current image as RGB8, top row first
+    std::vector<uint8_t> color_rgb8();
+
+    void build_bvh();
+
+    // Copies of host_bvh in the memory of NUMA nodes 1..n-1 (-affinity=numa)
+    void replicate_bvh();
+
+    // Stream the input file into the out-of-core cache (ooc_scene_writer)
+    bool write_out_of_core();
+    bool open_out_of_core();
+
+    // Load filename, build the BVH, materials and in-memory textures
+    bool load_scene(std::string const& scene_filename);
+
+    // Exchange the current scene with a resident one
+    void swap_scene(scene_state& scene);
 
     void render();
+
+    template<typename KParams, typename SParams>
+    void dispatch_frame(KParams const& kparams, SParams& sparams);
+
+    template<bool Textured, typename KParams, typename SParams>
+    void dispatch_kinds(KParams const& kparams, SParams& sparams);
+
+    template<unsigned Kinds, bool Textured, typename KParams, typename SParams>
+    void render_frame(KParams const& kparams, SParams& sparams);
+
     void resize(int w, int h);
 
+    // Restart accumulation
+    void clear_frame();
+
+    // RGBA32F accumulation buffer of the current render target
+    vec4* accum_buffer();
+
+    // Replace the image with accum (mean of samples samples), e.g. merged
+    // from partial renders
+    void set_accum(vec4 const* accum, unsigned samples);
+
 };
 
 } // namespace visionaray
@@ -2,6 +2,13 @@
 // See the LICENSE file for details.
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include <Support/CmdLine.h>
 #include <Support/CmdLineUtil.h>
 
@@ -12,9 +19,14 @@
 #include <visionaray/scheduler.h>
 
 #include <common/image.h>
+#include <common/make_materials.h>
 #include <common/model.h>
 #include <common/obj_loader.h>
 
+#include "kernel.h"
+#include "parallel_for.h"
+#include "pixel_convert.h"
+
 namespace visionaray
 {
 
@@ -45,10 +57,19 @@ renderer<host_ray_type>::renderer()
         cl::init(this->initial_camera)
         ) );
 
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "camera-path",
+        cl::Desc("Text file with one camera per view (format of -camera), renders numbered PNGs"),
+        cl::ArgRequired,
+        cl::init(this->camera_path_filename)
+        ) );
+
     add_cmdline_option( cl::makeOption<bvh_build_strategy&>({
             { "default",            Binned,         "Binned SAH" },
             { "split",              Split,          "Binned SAH with spatial splits" },
-            { "lbvh",               LBVH,           "LBVH (CPU)" }
+            { "lbvh",               LBVH,           "LBVH (CPU)" },
+            { "auto",               Auto,           "Choose from scene statistics and spp" }
         },
         "bvh",
         cl::Desc("BVH build strategy"),
@@ -56,6 +77,288 @@ renderer<host_ray_type>::renderer()
         cl::init(this->build_strategy)
         ) );
 
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "split-budget",
+        cl::Desc("Spatial splits: maximum number of references per primitive (>= 1)"),
+        cl::ArgRequired,
+        cl::init(this->split_max_duplication)
+        ) );
+
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "split-alpha",
+        cl::Desc("Spatial splits: minimum child overlap relative to the root surface area"),
+        cl::ArgRequired,
+        cl::init(this->split_alpha)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "split-min-refs",
+        cl::Desc("Spatial splits: minimum number of references in a node"),
+        cl::ArgRequired,
+        cl::init(this->split_min_references)
+        ) );
+
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "presplit",
+        cl::Desc("Pre-split slivers for default/lbvh builds: maximum number of references per primitive (1 = off)"),
+        cl::ArgRequired,
+        cl::init(this->presplit_max_duplication)
+        ) );
+
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "presplit-ratio",
+        cl::Desc("Pre-split triangles whose bbox-to-area ratio exceeds this value"),
+        cl::ArgRequired,
+        cl::init(this->presplit_min_ratio)
+        ) );
+
+    add_cmdline_option( cl::makeOption<bool&>(
+        cl::Parser<>(),
+        "bvh-stats",
+        cl::Desc("Print BVH quality and memory statistics"),
+        cl::ArgDisallowed,
+        cl::init(this->show_bvh_stats)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "bvh-stats-json",
+        cl::Desc("Write BVH statistics to JSON file"),
+        cl::ArgRequired,
+        cl::init(this->bvh_stats_filename)
+        ) );
+
+    add_cmdline_option( cl::makeOption<unsigned&>(
+        cl::Parser<>(),
+        "bounces",
+        cl::Desc("Maximum path length (number of surface interactions)"),
+        cl::ArgRequired,
+        cl::init(this->bounces)
+        ) );
+
+    add_cmdline_option( cl::makeOption<unsigned&>(
+        cl::Parser<>(),
+        "rr-depth",
+        cl::Desc("Number of bounces before Russian roulette starts"),
+        cl::ArgRequired,
+        cl::init(this->rr_depth)
+        ) );
+
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "compact",
+        cl::Desc("Finish packets as single rays once this fraction of lanes or less is alive (0 = off)"),
+        cl::ArgRequired,
+        cl::init(this->compact_threshold)
+        ) );
+
+    add_cmdline_option( cl::makeOption<bool&>(
+        cl::Parser<>(),
+        "render-stats",
+        cl::Desc("Print per-frame closest-hit and shadow ray statistics"),
+        cl::ArgDisallowed,
+        cl::init(this->show_render_stats)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "ooc",
+        cl::Desc("Out-of-core cache file, streamed from the input file if it does not exist"),
+        cl::ArgRequired,
+        cl::init(this->ooc_filename)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "ooc-budget",
+        cl::Desc("Out-of-core resident memory budget in MB (0 = unlimited)"),
+        cl::ArgRequired,
+        cl::init(this->ooc_budget)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "ooc-treelet",
+        cl::Desc("Out-of-core treelet size in primitives"),
+        cl::ArgRequired,
+        cl::init(this->ooc_treelet_prims)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "texture-cache",
+        cl::Desc("Tiled texture cache file, created from the model's textures if it does not exist"),
+        cl::ArgRequired,
+        cl::init(this->texture_cache_filename)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "texture-budget",
+        cl::Desc("Texture cache resident memory budget in MB (0 = unlimited)"),
+        cl::ArgRequired,
+        cl::init(this->texture_budget)
+        ) );
+
+    add_cmdline_option( cl::makeOption<float&>(
+        cl::Parser<>(),
+        "weld",
+        cl::Desc("Weld obj vertices closer than this distance at load time (0 = off)"),
+        cl::ArgRequired,
+        cl::init(this->weld_epsilon)
+        ) );
+
+    add_cmdline_option( cl::makeOption<bool&>(
+        cl::Parser<>(),
+        "dedup",
+        cl::Desc("Drop usemtl groups that repeat an earlier group with the same material at load time"),
+        cl::ArgDisallowed,
+        cl::init(this->dedup_groups)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "shm",
+        cl::Desc("Render into a POSIX shared-memory framebuffer with this name (e.g. /raytracer)"),
+        cl::ArgRequired,
+        cl::init(this->shm_name)
+        ) );
+
+    add_cmdline_option( cl::makeOption<bool&>(
+        cl::Parser<>(),
+        "shm-accum",
+        cl::Desc("Place the float accumulation buffer in the shared-memory framebuffer, too"),
+        cl::ArgDisallowed,
+        cl::init(this->shm_accum)
+        ) );
+
+    add_cmdline_option( cl::makeOption<stream_format&>({
+            { "raw",                RawStream,      "RGB24 frames" },
+            { "y4m",                Y4MStream,      "YUV4MPEG2 (4:4:4)" }
+        },
+        "stream",
+        cl::Desc("Render -frames frames and stream them uncompressed instead of writing a PNG"),
+        cl::ArgRequired,
+        cl::init(this->stream)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "stream-out",
+        cl::Desc("Stream output file or FIFO (- = stdout)"),
+        cl::ArgRequired,
+        cl::init(this->stream_filename)
+        ) );
+
+    add_cmdline_option( cl::makeOption<unsigned&>(
+        cl::Parser<>(),
+        "frames",
+        cl::Desc("Number of frames: turntable frames when streaming, or frames interpolated along -camera-path"),
+        cl::ArgRequired,
+        cl::init(this->num_frames)
+        ) );
+
+    add_cmdline_option( cl::makeOption<unsigned&>(
+        cl::Parser<>(),
+        "fps",
+        cl::Desc("Frame rate written to the y4m stream header"),
+        cl::ArgRequired,
+        cl::init(this->fps)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "serve",
+        cl::Desc("Keep scenes resident and serve render requests on this Unix domain socket"),
+        cl::ArgRequired,
+        cl::init(this->serve_socket)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "serve-scenes",
+        cl::Desc("Render server: maximum number of resident scenes"),
+        cl::ArgRequired,
+        cl::init(this->serve_scenes)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "coordinator",
+        cl::Desc("Distribute the frames to workers connecting to this address (host:port or Unix socket path)"),
+        cl::ArgRequired,
+        cl::init(this->coordinator_address)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "worker",
+        cl::Desc("Render tiles for the coordinator at this address (host:port or Unix socket path)"),
+        cl::ArgRequired,
+        cl::init(this->worker_address)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "workers",
+        cl::Desc("Coordinator: number of workers to wait for before the first frame"),
+        cl::ArgRequired,
+        cl::init(this->min_workers)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "tile-size",
+        cl::Desc("Coordinator: edge length of the tiles assigned to workers in pixels"),
+        cl::ArgRequired,
+        cl::init(this->tile_size)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "tile-spp",
+        cl::Desc("Coordinator: samples per tile assignment (0 = all of -spp)"),
+        cl::ArgRequired,
+        cl::init(this->tile_spp)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "worker-timeout",
+        cl::Desc("Coordinator: seconds to wait for a worker when none is left before giving up (0 = wait forever)"),
+        cl::ArgRequired,
+        cl::init(this->worker_timeout)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "tile-timeout",
+        cl::Desc("Coordinator: seconds a worker may take for one assignment before it is dropped (0 = no limit)"),
+        cl::ArgRequired,
+        cl::init(this->tile_timeout)
+        ) );
+
+    add_cmdline_option( cl::makeOption<size_t&>(
+        cl::Parser<>(),
+        "sample-first",
+        cl::Desc("Index of the first sample, -spp samples from there on are rendered"),
+        cl::ArgRequired,
+        cl::init(this->sample_first)
+        ) );
+
+    add_cmdline_option( cl::makeOption<std::string&>(
+        cl::Parser<>(),
+        "accum-out",
+        cl::Desc("Write the float accumulation buffer and sample range instead of a PNG (see raytracer-merge)"),
+        cl::ArgRequired,
+        cl::init(this->accum_filename)
+        ) );
+
     add_cmdline_option( cl::makeOption<size_t&>(
         cl::Parser<>(),
         "width",
@@ -80,6 +383,27 @@ renderer<host_ray_type>::renderer()
         cl::init(this->num_threads)
         ) );
 
+    add_cmdline_option( cl::makeOption<affinity_policy&>({
+            { "compact",            CompactAffinity, "Pin threads to CPUs, filling one NUMA node after the other" },
+            { "scatter",            ScatterAffinity, "Pin threads to CPUs, round-robin over the NUMA nodes" },
+            { "numa",               NUMAAffinity,   "Bind threads to NUMA nodes, replicate the BVH per node" }
+        },
+        "affinity",
+        cl::Desc("Render thread placement"),
+        cl::ArgRequired,
+        cl::init(this->affinity)
+        ) );
+
+    add_cmdline_option( cl::makeOption<huge_page_mode&>({
+            { "off",                NoHugePages,            "4 KB pages" },
+            { "transparent",        TransparentHugePages,   "Transparent huge pages (madvise)" }
+        },
+        "hugepages",
+        cl::Desc("Huge pages for primitives, BVH and framebuffer"),
+        cl::ArgRequired,
+        cl::init(this->huge_pages)
+        ) );
+
     add_cmdline_option( cl::makeOption<size_t&>(
         cl::Parser<>(),
         "spp",
@@ -117,8 +441,29 @@ void renderer<host_ray_type>::init(int argc, char** argv)
 
     cmd.parse(args, false);
 
+    auto before = list_threads();
+
     host_sched.reset(num_threads);
 
+    auto render_threads = new_threads(before, list_threads());
+
+    // Helper threads for pixel conversion etc. run between frames, they
+    // share the CPUs of the render threads
+    before = list_threads();
+
+    set_parallel_for_threads(static_cast<unsigned>(num_threads));
+
+    auto helper_threads = new_threads(before, list_threads());
+
+    if (affinity != NoAffinity)
+    {
+        std::string summary;
+        size_t pinned = pin_threads(render_threads, affinity, summary);
+        std::cout << "Affinity: pinned " << pinned << " render threads, " << summary << '\n';
+
+        pin_threads(helper_threads, affinity, summary);
+    }
+
     resize(width, height);
 }
 
@@ -128,6 +473,272 @@ void renderer<host_ray_type>::add_cmdline_option( std::shared_ptr<support::cl::O
     options.emplace_back(option);
 }
 
+//-------------------------------------------------------------------------------------------------
+// Build the BVH over mod.primitives
+//
+
+template<typename host_ray_type>
+void renderer<host_ray_type>::build_bvh()
+{
+    bvh_build_strategy strategy = build_strategy;
+    float max_duplication = split_max_duplication;
+
+    if (strategy == Auto)
+    {
+        auto stats = gather_scene_statistics(mod.primitives, mod.bbox);
+
+        // One closest-hit and one shadow ray per bounce
+        auto choice = choose_build_strategy(stats, width, height, spp, 2 * bounces, num_threads);
+
+        std::cout << "Auto BVH: " << choice.reason << '\n';
+
+        strategy = choice.strategy;
+
+        // The command line budget is a hard limit
+        max_duplication = std::min(max_duplication, choice.max_duplication);
+    }
+
+    aligned_vector<triangle_reference> refs;
+
+    if (strategy != Split && presplit_max_duplication > 1.0f)
+    {
+        presplit_stats stats;
+
+        refs = presplit_triangles(
+                mod.primitives.data(),
+                mod.primitives.size(),
+                presplit_max_duplication,
+                presplit_min_ratio,
+                stats
+                );
+
+        std::cout << "Pre-split: " << stats.num_candidates << " of " << stats.num_primitives
+                  << " triangles split into " << stats.num_references << " references (duplication "
+                  << stats.duplication() << ", budget " << presplit_max_duplication << ")\n";
+    }
+
+    if (strategy == LBVH)
+    {
+        lbvh_builder builder;
+
+        if (!refs.empty())
+        {
+            host_bvh = build_from_references(
+                    builder,
+                    mod.primitives.data(),
+                    mod.primitives.size(),
+                    refs
+                    );
+        }
+        else
+        {
+            host_bvh = builder.build(
+                    index_bvh<model::triangle_type>{},
+                    mod.primitives.data(),
+                    mod.primitives.size()
+                    );
+        }
+    }
+    else if (strategy == Split)
+    {
+        split_bvh_builder builder;
+        builder.set_max_duplication(max_duplication);
+        builder.set_alpha(split_alpha);
+        builder.set_min_split_references(split_min_references);
+
+        host_bvh = builder.build(
+                mod.primitives.data(),
+                mod.primitives.size()
+                );
+
+        auto const& stats = builder.stats();
+        std::cout << "Split BVH: " << stats.num_references << " references for "
+                  << stats.num_primitives << " primitives (duplication " << stats.duplication()
+                  << ", budget " << max_duplication << "), "
+                  << stats.num_spatial_splits << " spatial splits, "
+                  << stats.num_budget_rejects << " rejected by budget\n";
+    }
+    else
+    {
+        binned_sah_builder builder;
+
+        if (!refs.empty())
+        {
+            host_bvh = build_from_references(
+                    builder,
+                    mod.primitives.data(),
+                    mod.primitives.size(),
+                    refs
+                    );
+        }
+        else
+        {
+            host_bvh = builder.build(
+                    index_bvh<model::triangle_type>{},
+                    mod.primitives.data(),
+                    mod.primitives.size()
+                    );
+        }
+    }
+
+    replicate_bvh();
+
+    if (huge_pages != NoHugePages)
+    {
+        auto advise = [this](auto& array)
+        {
+            return use_huge_pages(array.data(), array.size() * sizeof(array[0]), huge_pages);
+        };
+
+        huge_page_stats bvh_stats;
+        bvh_stats += advise(host_bvh.nodes());
+        bvh_stats += advise(host_bvh.primitives());
+        bvh_stats += advise(host_bvh.indices());
+
+        // Copies are collapsed on their node (see replicate_bvh())
+        for (size_t node = 1; node < bvh_replicas.size(); ++node)
+        {
+            run_on_node(static_cast<int>(node), [&]()
+            {
+                auto& replica = bvh_replicas[node];
+                bvh_stats += advise(replica.nodes());
+                bvh_stats += advise(replica.primitives());
+                bvh_stats += advise(replica.indices());
+            });
+        }
+
+        auto prim_stats = advise(mod.primitives);
+
+        print_huge_page_stats(std::cout, "Huge pages, BVH", bvh_stats);
+        print_huge_page_stats(std::cout, "Huge pages, primitives", prim_stats);
+    }
+}
+
+template<typename host_ray_type>
+void renderer<host_ray_type>::replicate_bvh()
+{
+    bvh_replicas.clear();
+
+    size_t num_nodes = num_numa_nodes();
+
+    if (affinity != NUMAAffinity || num_nodes < 2)
+    {
+        return;
+    }
+
+    // Node 0 uses host_bvh, the copies are written from threads on their node
+    bvh_replicas.resize(num_nodes);
+
+    for (size_t node = 1; node < num_nodes; ++node)
+    {
+        run_on_node(static_cast<int>(node), [&]()
+        {
+            bvh_replicas[node] = host_bvh;
+        });
+    }
+
+    std::cout << "Replicated BVH on " << num_nodes << " NUMA nodes\n";
+}
+
+//-------------------------------------------------------------------------------------------------
+// Create the out-of-core cache file while loading, without keeping the scene
+//
+
+template<typename host_ray_type>
+bool renderer<host_ray_type>::write_out_of_core()
+{
+    std::cout << "Writing out-of-core cache " << ooc_filename << "...\n";
+
+    ooc_scene_writer writer(ooc_filename, ooc_treelet_prims);
+    bool ok = true;
+
+    mod.primitive_sink = [&](model::triangle_list& prims)
+    {
+        ok = ok && writer.add(prims.data(), prims.size());
+    };
+
+    bool loaded = mod.load(filename);
+
+    mod.primitive_sink = nullptr;
+
+    if (!loaded)
+    {
+        std::cerr << "Failed loading obj model\n";
+        return false;
+    }
+
+    if (!ok || !writer.finish(mod.materials))
+    {
+        std::cerr << "Cannot write out-of-core cache file: " << ooc_filename << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Switch to the out-of-core cache file
+//
+
+template<typename host_ray_type>
+bool renderer<host_ray_type>::open_out_of_core()
+{
+    if (!ooc.open(ooc_filename, ooc_budget * 1024 * 1024))
+    {
+        std::cerr << "Cannot open out-of-core cache file: " << ooc_filename << '\n';
+        return false;
+    }
+
+    mod.bbox = ooc.bbox();
+    mod.materials = ooc.materials();
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Resident scenes (render server)
+//
+
+template<typename host_ray_type>
+bool renderer<host_ray_type>::load_scene(std::string const& scene_filename)
+{
+    mod = model{};
+    mod.weld_epsilon = weld_epsilon;
+    mod.dedup_groups = dedup_groups;
+
+    if (!mod.load(scene_filename))
+    {
+        return false;
+    }
+
+    filename = scene_filename;
+
+    build_bvh();
+
+    materials = make_materials(plastic<float>{}, mod.materials);
+    binned_materials = make_material_bins(make_scene_materials(mod.materials));
+
+    // Mip pyramids replace the loader's textures
+    textures = make_texture_set(mod);
+    mod.textures.clear();
+    mod.texture_map.clear();
+
+    return true;
+}
+
+template<typename host_ray_type>
+void renderer<host_ray_type>::swap_scene(scene_state& scene)
+{
+    using std::swap;
+
+    swap(mod, scene.mod);
+    swap(materials, scene.materials);
+    swap(binned_materials, scene.binned_materials);
+    swap(textures, scene.textures);
+    swap(host_bvh, scene.host_bvh);
+    swap(bvh_replicas, scene.bvh_replicas);
+}
+
 //-------------------------------------------------------------------------------------------------
 // Render function, implements the kernel
 //
@@ -140,15 +751,9 @@ void renderer<host_ray_type>::render()
     jps.spp = 1;
     jps.sfactor = alpha;
     jps.dfactor = 1.0f - alpha;
-    auto sparams = make_sched_params(
-            jps,
-            cam,
-            host_rt
-            );
-
     using bvh_ref = index_bvh<model::triangle_type>::bvh_ref;
     std::vector<bvh_ref> bvhs;
-    bvhs.push_back(host_bvh.ref());
+    bvhs.push_back(ooc.is_open() ? ooc.ref() : host_bvh.ref());
 
     // headlight
     point_light<float> headlight;
@@ -161,19 +766,124 @@ void renderer<host_ray_type>::render()
     std::vector<point_light<float>> lights{headlight};
 
     auto kparams = make_kernel_params(
-            mod.primitives.data(),
-            mod.primitives.data() + mod.primitives.size(),
+            bvhs.data(),
+            bvhs.data() + bvhs.size(),
             materials.data(),
             lights.data(),
             lights.data() + lights.size(),
-            4,                          // max bounces
+            bounces,                    // max bounces
             0.001f,                     // self-intersection
             vec4(0.2, 0.2, 0.5, 1.0),   // bg-color
             vec4(0.0)
             );
 
-    pathtracing::kernel<decltype(kparams)> kernel;
+    stats.reset();
+
+    if (shm_rt.is_open())
+    {
+        auto sparams = make_sched_params(jps, cam, shm_rt);
+        dispatch_frame(kparams, sparams);
+    }
+    else
+    {
+        auto sparams = make_sched_params(jps, cam, host_rt);
+        dispatch_frame(kparams, sparams);
+    }
+
+    ooc.end_frame();
+    tex_cache.end_frame();
+
+    fb_released = false;
+}
+
+template<typename host_ray_type>
+template<typename KParams, typename SParams>
+void renderer<host_ray_type>::dispatch_frame(KParams const& kparams, SParams& sparams)
+{
+    // Tile assignments only render a part of the image
+    if (scissor_box.w > 0 && scissor_box.h > 0)
+    {
+        sparams.scissor_box = scissor_box;
+    }
+
+    // Untextured scenes (e.g. CAD data) use kernels without the texture
+    // lookup, the loader does not store tex coords for them
+    if (textures.empty())
+    {
+        dispatch_kinds<false>(kparams, sparams);
+    }
+    else
+    {
+        dispatch_kinds<true>(kparams, sparams);
+    }
+}
+
+template<typename host_ray_type>
+template<bool Textured, typename KParams, typename SParams>
+void renderer<host_ray_type>::dispatch_kinds(KParams const& kparams, SParams& sparams)
+{
+    // Use the kernel specialization with the fewest material kinds that
+    // covers the scene
+    unsigned kinds = binned_materials.present_kinds();
+
+    if ((kinds & ~MatteKinds) == 0)
+    {
+        render_frame<MatteKinds, Textured>(kparams, sparams);
+    }
+    else if ((kinds & ~PlasticKinds) == 0)
+    {
+        render_frame<PlasticKinds, Textured>(kparams, sparams);
+    }
+    else if ((kinds & ~DiffuseKinds) == 0)
+    {
+        render_frame<DiffuseKinds, Textured>(kparams, sparams);
+    }
+    else if ((kinds & ~EmissiveKinds) == 0)
+    {
+        render_frame<EmissiveKinds, Textured>(kparams, sparams);
+    }
+    else
+    {
+        render_frame<AllKinds, Textured>(kparams, sparams);
+    }
+}
+
+template<typename host_ray_type>
+template<unsigned Kinds, bool Textured, typename KParams, typename SParams>
+void renderer<host_ray_type>::render_frame(KParams const& kparams, SParams& sparams)
+{
+    path_kernel<KParams, Kinds, Textured> kernel;
     kernel.params = kparams;
+    kernel.materials = &binned_materials;
+    kernel.textures = &textures;
+    kernel.cone_spread = 2.0f * std::tan(cam.fovy() * 0.5f) / height;
+    kernel.stats = show_render_stats ? &stats : nullptr;
+    kernel.rr_depth = rr_depth;
+    kernel.compact_threshold = compact_threshold;
+    kernel.sample_index = sample_first + frame_num - 1;
+
+    // Each thread traverses the BVH copy of its NUMA node
+    using prim_iterator = typename path_kernel<KParams, Kinds, Textured>::prim_iterator;
+    std::vector<index_bvh<model::triangle_type>::bvh_ref> node_bvhs;
+    std::vector<prim_iterator> node_prims;
+
+    if (!bvh_replicas.empty() && !ooc.is_open())
+    {
+        node_bvhs.push_back(host_bvh.ref());
+
+        for (size_t node = 1; node < bvh_replicas.size(); ++node)
+        {
+            node_bvhs.push_back(bvh_replicas[node].ref());
+        }
+
+        for (auto& ref : node_bvhs)
+        {
+            node_prims.push_back(&ref);
+        }
+
+        kernel.node_prims = node_prims.data();
+        kernel.num_nodes = static_cast<unsigned>(node_prims.size());
+    }
 
     host_sched.frame(
         kernel,
@@ -181,20 +891,102 @@ void renderer<host_ray_type>::render()
         );
 }
 
+//-------------------------------------------------------------------------------------------------
+// Direct access to the accumulation buffer
+//
+
+template<typename host_ray_type>
+vec4* renderer<host_ray_type>::accum_buffer()
+{
+    return shm_rt.is_open() ? shm_rt.accum() : host_rt.accum();
+}
+
+template<typename host_ray_type>
+void renderer<host_ray_type>::set_accum(vec4 const* accum, unsigned samples)
+{
+    size_t count = width * height;
+
+    auto* color = shm_rt.is_open() ? shm_rt.color() : host_rt.color();
+
+    if (shm_rt.is_open())
+    {
+        shm_rt.begin_frame();
+    }
+
+    std::copy(accum, accum + count, accum_buffer());
+    convert_pixels(color, PF_RGBA8, accum, PF_RGBA32F, count);
+
+    fb_released = false;
+
+    if (shm_rt.is_open())
+    {
+        shm_rt.end_frame();
+    }
+
+    frame_num = samples;
+}
+
 //-------------------------------------------------------------------------------------------------
 // resize event
 //
 
 template<typename host_ray_type>
-void renderer<host_ray_type>::resize(int w, int h)
+void renderer<host_ray_type>::clear_frame()
 {
     frame_num = 0;
-    host_rt.clear_color_buffer();
 
+    // Released pages read as zero, clearing them here would place them on
+    // this thread's node before the render threads get to touch them
+    if (!fb_released)
+    {
+        host_rt.clear_color_buffer();
+    }
+
+    if (shm_rt.is_open())
+    {
+        shm_rt.clear_color_buffer();
+    }
+}
+
+template<typename host_ray_type>
+void renderer<host_ray_type>::resize(int w, int h)
+{
     cam.set_viewport(0, 0, w, h);
     float aspect = w / static_cast<float>(h);
     cam.perspective(45.0f * constants::degrees_to_radians<float>(), aspect, 0.001f, 1000.0f);
     host_rt.resize(w, h);
+
+    if (affinity == NUMAAffinity)
+    {
+        // The render threads first-touch the framebuffer pages they write.
+        // release_pages() keeps the partial pages at either end, so the
+        // buffer is cleared first
+        size_t count = size_t(w) * h;
+        host_rt.clear_color_buffer();
+        release_pages(host_rt.color(), count * sizeof(*host_rt.color()));
+        release_pages(host_rt.accum(), count * sizeof(*host_rt.accum()));
+        fb_released = true;
+    }
+
+    if (huge_pages != NoHugePages)
+    {
+        // Released pages are only advised, the render threads allocate them
+        size_t count = size_t(w) * h;
+        auto fb_stats = use_huge_pages(host_rt.color(), count * sizeof(*host_rt.color()), huge_pages, !fb_released);
+        fb_stats += use_huge_pages(host_rt.accum(), count * sizeof(*host_rt.accum()), huge_pages, !fb_released);
+        print_huge_page_stats(std::cout, "Huge pages, framebuffer", fb_stats);
+    }
+
+    if (!shm_name.empty())
+    {
+        bool ok = shm_rt.is_open() ? shm_rt.resize(w, h) : shm_rt.open(shm_name, shm_accum, w, h);
+        if (!ok)
+        {
+            std::cerr << "Cannot create shared-memory framebuffer: " << shm_name << '\n';
+        }
+    }
+
+    clear_frame();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -202,38 +994,40 @@ void renderer<host_ray_type>::resize(int w, int h)
 //
 
 template<typename host_ray_type>
-void renderer<host_ray_type>::save_as_png()
+std::vector<uint8_t> renderer<host_ray_type>::color_rgb8()
 {
-    // Swizzle to RGB8 for compatibility with pnm image
-    std::vector<vector<4, unorm<8>>> rgba(width * height);
-    memcpy(rgba.data(), host_rt.color(), width * height * 4);
-    std::vector<vector<3, unorm<8>>> rgb(width * height);
-    for (size_t i=0; i<rgb.size(); ++i)
-    {
-        rgb[i] = vector<3, unorm<8>>(rgba[i].x, rgba[i].y, rgba[i].z);
-    }
+    // Rotate by 180 degrees, i.e. reverse the pixel order
+    size_t count = width * height;
+    auto const* rgba = reinterpret_cast<uint32_t const*>(shm_rt.is_open() ? shm_rt.color() : host_rt.color());
+    std::vector<uint32_t> rotated(count);
 
-    // Flip
-    std::vector<vector<3, unorm<8>>> flipped(width * height);
-    for (int y = 0; y < height; ++y)
+    parallel_for(0, count, 1 << 16, [&](size_t first, size_t last)
     {
-      for (int x = 0; x < width; ++x)
-      {
-        auto xx = width - x - 1;
-        auto yy = height - y - 1;
-        flipped[y * width + x] = rgb[yy * width + xx];
-      }
-    }
+        std::reverse_copy(rgba + count - last, rgba + count - first, rotated.data() + first);
+    });
+
+    // Swizzle to RGB8
+    std::vector<uint8_t> rgb(count * 3);
+    convert_pixels(rgb.data(), PF_RGB8, rotated.data(), PF_RGBA8, count);
+
+    return rgb;
+}
+
+template<typename host_ray_type>
+bool renderer<host_ray_type>::save_as_png(std::string const& filename)
+{
+    // RGB8 for compatibility with pnm image
+    auto flipped = color_rgb8();
 
     image img(
         width,
         height,
         PF_RGB8,
-        reinterpret_cast<uint8_t const*>(flipped.data())
+        flipped.data()
         );
 
     image::save_option opt;
-    img.save(png_filename, {opt});
+    return img.save(filename, {opt});
 }
 
 } // namespace visionaray
@@ -0,0 +1,143 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <common/make_materials.h>
+
+#include "shading.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Map OBJ illumination models to material types
+//
+//  0, 1        : matte (diffuse only)
+//  2           : plastic (diffuse and specular highlight)
+//  3, 5, 8     : mirror
+//  4, 6, 7, 9  : glass if the material is transmissive, mirror otherwise
+//
+// Materials with an emissive color are emissive regardless of illum
+//
+
+aligned_vector<scene_material> make_scene_materials(aligned_vector<sg::obj_material> const& materials)
+{
+    return make_materials(
+        scene_material{},
+        materials,
+        [](aligned_vector<scene_material>& cont, sg::obj_material const& mat)
+        {
+            bool transmissive = mat.transmission > 0.0f;
+
+            if (mat.ce.x > 0.0f || mat.ce.y > 0.0f || mat.ce.z > 0.0f)
+            {
+                emissive<float> em;
+                em.ce() = from_rgb(mat.ce);
+                em.ls() = 1.0f;
+                cont.emplace_back(em);
+            }
+            else if (mat.illum == 0 || mat.illum == 1)
+            {
+                matte<float> ma;
+                ma.ca() = from_rgb(mat.ca);
+                ma.cd() = from_rgb(mat.cd);
+                ma.ka() = 1.0f;
+                ma.kd() = 1.0f;
+                cont.emplace_back(ma);
+            }
+            else if ((mat.illum == 4 || mat.illum == 6 || mat.illum == 7 || mat.illum == 9) && transmissive)
+            {
+                glass<float> gl;
+                gl.ct() = from_rgb(mat.cd);
+                gl.kt() = 1.0f;
+                gl.cr() = from_rgb(mat.cs);
+                gl.kr() = 1.0f;
+                gl.ior() = from_rgb(mat.ior);
+                cont.emplace_back(gl);
+            }
+            else if (mat.illum >= 3 && mat.illum <= 9)
+            {
+                mirror<float> mi;
+                mi.cr() = from_rgb(mat.cs);
+                mi.kr() = 1.0f;
+                mi.ior() = from_rgb(mat.ior);
+                mi.absorption() = from_rgb(mat.absorption);
+                cont.emplace_back(mi);
+            }
+            else
+            {
+                plastic<float> pl;
+                pl.ca() = from_rgb(mat.ca);
+                pl.cd() = from_rgb(mat.cd);
+                pl.cs() = from_rgb(mat.cs);
+                pl.ka() = 1.0f;
+                pl.kd() = 1.0f;
+                pl.ks() = 1.0f;
+                pl.specular_exp() = mat.specular_exp;
+                cont.emplace_back(pl);
+            }
+        }
+        );
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Group materials by kind
+//
+
+template <typename T>
+static void add_material(
+        material_bins&          bins,
+        material_kind           kind,
+        aligned_vector<T>&      materials,
+        T const&                mat
+        )
+{
+    bins.kinds.push_back(kind);
+    bins.slots.push_back(static_cast<unsigned>(materials.size()));
+    materials.push_back(mat);
+}
+
+material_bins make_material_bins(aligned_vector<scene_material> const& materials)
+{
+    material_bins result;
+
+    for (auto const& mat : materials)
+    {
+        if (auto pl = mat.as<plastic<float>>())
+        {
+            add_material(result, PlasticMaterial, result.plastics, *pl);
+        }
+        else if (auto ma = mat.as<matte<float>>())
+        {
+            add_material(result, MatteMaterial, result.mattes, *ma);
+        }
+        else if (auto mi = mat.as<mirror<float>>())
+        {
+            add_material(result, MirrorMaterial, result.mirrors, *mi);
+        }
+        else if (auto gl = mat.as<glass<float>>())
+        {
+            add_material(result, GlassMaterial, result.glasses, *gl);
+        }
+        else if (auto em = mat.as<emissive<float>>())
+        {
+            add_material(result, EmissiveMaterial, result.emissives, *em);
+        }
+    }
+
+    return result;
+}
+
+unsigned material_bins::present_kinds() const
+{
+    unsigned result = 0;
+
+    for (auto kind : kinds)
+    {
+        result |= kind_bit(static_cast<material_kind>(kind));
+    }
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,355 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <visionaray/aligned_vector.h>
+#include <visionaray/math/math.h>
+#include <visionaray/generic_material.h>
+#include <visionaray/material.h>
+#include <visionaray/shade_record.h>
+#include <visionaray/spectrum.h>
+
+#include <common/sg/material.h>
+
+#include "simd_lanes.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Material kinds, one SIMD shading pass per kind that is present in a packet
+//
+
+enum material_kind : uint8_t
+{
+    PlasticMaterial = 0,
+    MatteMaterial,
+    MirrorMaterial,
+    GlassMaterial,
+    EmissiveMaterial,
+    NumMaterialKinds
+};
+
+constexpr unsigned kind_bit(material_kind kind)
+{
+    return 1u << kind;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sets of material kinds the kernel is precompiled for. The renderer picks
+// the smallest set that covers the kinds present in the scene, shading code
+// for the other kinds is compiled out
+//
+
+constexpr unsigned MatteKinds       = kind_bit(MatteMaterial);
+constexpr unsigned PlasticKinds     = kind_bit(PlasticMaterial);
+constexpr unsigned DiffuseKinds     = kind_bit(PlasticMaterial) | kind_bit(MatteMaterial);
+constexpr unsigned EmissiveKinds    = DiffuseKinds | kind_bit(EmissiveMaterial);
+constexpr unsigned AllKinds         = (1u << NumMaterialKinds) - 1;
+
+
+//-------------------------------------------------------------------------------------------------
+// Conversion from OBJ materials, driven by the illumination model
+//
+
+using scene_material = generic_material<
+        plastic<float>,
+        matte<float>,
+        mirror<float>,
+        glass<float>,
+        emissive<float>
+        >;
+
+aligned_vector<scene_material> make_scene_materials(aligned_vector<sg::obj_material> const& materials);
+
+
+//-------------------------------------------------------------------------------------------------
+// Scene materials grouped by kind. Material id (geom_id of the primitive)
+// i is the slots[i]-th material in the array of kind kinds[i]
+//
+
+struct material_bins
+{
+    aligned_vector<uint8_t>         kinds;
+    aligned_vector<unsigned>        slots;
+
+    aligned_vector<plastic<float>>  plastics;
+    aligned_vector<matte<float>>    mattes;
+    aligned_vector<mirror<float>>   mirrors;
+    aligned_vector<glass<float>>    glasses;
+    aligned_vector<emissive<float>> emissives;
+
+    // Bit set of the kinds that are present
+    unsigned present_kinds() const;
+};
+
+material_bins make_material_bins(aligned_vector<scene_material> const& materials);
+
+
+//-------------------------------------------------------------------------------------------------
+// The materials of the lanes of a packet, packed into one SIMD material per
+// kind. Lanes of other kinds hold a copy of a material of the same kind and
+// are masked out when the results are combined. Kinds not in Kinds are never
+// shaded (the lanes stay black and their paths end)
+//
+
+template <typename S, unsigned Kinds = AllKinds>
+struct packed_materials
+{
+    using M = simd::mask_type_t<S>;
+    using I = simd::int_type_t<S>;
+    using V = vector<3, S>;
+    using C = spectrum<S>;
+
+    // Bit i is set if lanes of material_kind i are present
+    unsigned            present = 0;
+    M                   masks[NumMaterialKinds];
+
+    plastic<S>          plastics;
+    matte<S>            mattes;
+    mirror<S>           mirrors;
+    glass<S>            glasses;
+    emissive<S>         emissives;
+
+    // Light emitted by the surface towards the viewer
+    C emission(shade_record<S> const& sr) const
+    {
+        C result(0.0);
+
+        if constexpr (compiled(EmissiveMaterial))
+        {
+            if (present & kind_bit(EmissiveMaterial))
+            {
+                result = select(masks[EmissiveMaterial], emissives.shade(sr), result);
+            }
+        }
+
+        return result;
+    }
+
+    // Reflected light from direction sr.light_dir, 0 for emissive surfaces
+    // and for specular surfaces that are only handled by sample()
+    C shade(shade_record<S> const& sr) const
+    {
+        C result(0.0);
+
+        shade_record<S> front = facing(sr);
+
+        if constexpr (compiled(PlasticMaterial))
+        {
+            if (present & kind_bit(PlasticMaterial))
+            {
+                result = select(masks[PlasticMaterial], plastics.shade(front), result);
+            }
+        }
+
+        if constexpr (compiled(MatteMaterial))
+        {
+            if (present & kind_bit(MatteMaterial))
+            {
+                result = select(masks[MatteMaterial], mattes.shade(front), result);
+            }
+        }
+
+        return result;
+    }
+
+    // Sample a continuation direction, pdf stays 0 for emissive surfaces
+    template <typename Generator>
+    C sample(shade_record<S> const& sr, V& refl_dir, S& pdf, I& inter, Generator& gen) const
+    {
+        C result(0.0);
+
+        shade_record<S> front = facing(sr);
+
+        if constexpr (compiled(PlasticMaterial))
+        {
+            if (present & kind_bit(PlasticMaterial))
+            {
+                sample_kind(plastics, masks[PlasticMaterial], front, result, refl_dir, pdf, inter, gen);
+            }
+        }
+
+        if constexpr (compiled(MatteMaterial))
+        {
+            if (present & kind_bit(MatteMaterial))
+            {
+                sample_kind(mattes, masks[MatteMaterial], front, result, refl_dir, pdf, inter, gen);
+            }
+        }
+
+        if constexpr (compiled(MirrorMaterial))
+        {
+            if (present & kind_bit(MirrorMaterial))
+            {
+                sample_kind(mirrors, masks[MirrorMaterial], front, result, refl_dir, pdf, inter, gen);
+            }
+        }
+
+        // Glass tells entering from leaving rays by the orientation of the normal
+        if constexpr (compiled(GlassMaterial))
+        {
+            if (present & kind_bit(GlassMaterial))
+            {
+                sample_kind(glasses, masks[GlassMaterial], sr, result, refl_dir, pdf, inter, gen);
+            }
+        }
+
+        return result;
+    }
+
+private:
+
+    static constexpr bool compiled(material_kind kind)
+    {
+        return (Kinds & kind_bit(kind)) != 0;
+    }
+
+    // Normals flipped to the side of the viewer
+    static shade_record<S> facing(shade_record<S> const& sr)
+    {
+        shade_record<S> result = sr;
+        result.normal = faceforward(sr.normal, -sr.view_dir, sr.geometric_normal);
+        result.geometric_normal = faceforward(sr.geometric_normal, -sr.view_dir, sr.geometric_normal);
+        return result;
+    }
+
+    template <typename Material, typename Generator>
+    static void sample_kind(
+            Material const&         mat,
+            M const&                mask,
+            shade_record<S> const&  sr,
+            C&                      result,
+            V&                      refl_dir,
+            S&                      pdf,
+            I&                      inter,
+            Generator&              gen
+            )
+    {
+        V d;
+        S p(0.0);
+        I it = 0;
+
+        auto f = mat.sample(sr, d, p, it, gen);
+
+        result   = select(mask, f, result);
+        refl_dir = select(mask, d, refl_dir);
+        pdf      = select(mask, p, pdf);
+        inter    = select(mask, it, inter);
+    }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Bin the active lanes by material kind and pack their materials
+//
+
+template <typename S, unsigned Kinds = AllKinds>
+inline packed_materials<S, Kinds> pack_materials(
+        material_bins const&                bins,
+        simd::int_type_t<S> const&          material_ids,
+        simd::mask_type_t<S> const&         active
+        )
+{
+    constexpr size_t N = simd::num_elements<S>::value;
+
+    packed_materials<S, Kinds> result;
+
+    lane_array<simd::int_type_t<S>> ids;
+    store_lanes<simd::int_type_t<S>>(ids, material_ids);
+    auto alive = mask_lanes<S>(active);
+
+    // Kind per lane, NumMaterialKinds for inactive lanes
+    std::array<uint8_t, N> lane_kinds;
+    std::array<int, NumMaterialKinds> first_lane;
+    first_lane.fill(-1);
+
+    for (size_t l = 0; l < N; ++l)
+    {
+        lane_kinds[l] = NumMaterialKinds;
+
+        if (alive[l] == 0.0f || ids[l] < 0 || static_cast<size_t>(ids[l]) >= bins.kinds.size())
+        {
+            continue;
+        }
+
+        lane_kinds[l] = bins.kinds[ids[l]];
+
+        if (first_lane[lane_kinds[l]] < 0)
+        {
+            first_lane[lane_kinds[l]] = static_cast<int>(l);
+        }
+
+        result.present |= kind_bit(static_cast<material_kind>(lane_kinds[l]));
+    }
+
+    result.present &= Kinds;
+
+    auto gather = [&](auto const& materials, material_kind kind, auto& dst)
+    {
+        using material_type = typename std::decay_t<decltype(materials)>::value_type;
+
+        if (!(result.present & kind_bit(kind)))
+        {
+            return;
+        }
+
+        std::array<material_type, N> lanes;
+        lane_array<S> in_kind;
+
+        unsigned fallback = bins.slots[ids[first_lane[kind]]];
+
+        for (size_t l = 0; l < N; ++l)
+        {
+            bool match = lane_kinds[l] == kind;
+            lanes[l] = materials[match ? bins.slots[ids[l]] : fallback];
+            in_kind[l] = match ? 1.0f : 0.0f;
+        }
+
+        result.masks[kind] = lanes_to_mask<S>(in_kind);
+
+        if constexpr (N == 1)
+        {
+            dst = lanes[0];
+        }
+        else
+        {
+            dst = simd::pack(lanes);
+        }
+    };
+
+    if constexpr ((Kinds & kind_bit(PlasticMaterial)) != 0)
+    {
+        gather(bins.plastics, PlasticMaterial, result.plastics);
+    }
+
+    if constexpr ((Kinds & kind_bit(MatteMaterial)) != 0)
+    {
+        gather(bins.mattes, MatteMaterial, result.mattes);
+    }
+
+    if constexpr ((Kinds & kind_bit(MirrorMaterial)) != 0)
+    {
+        gather(bins.mirrors, MirrorMaterial, result.mirrors);
+    }
+
+    if constexpr ((Kinds & kind_bit(GlassMaterial)) != 0)
+    {
+        gather(bins.glasses, GlassMaterial, result.glasses);
+    }
+
+    if constexpr ((Kinds & kind_bit(EmissiveMaterial)) != 0)
+    {
+        gather(bins.emissives, EmissiveMaterial, result.emissives);
+    }
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,213 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm_render_target.h"
+
+namespace visionaray
+{
+
+static constexpr uint32_t header_version = 1;
+static constexpr size_t page_size = 4096;
+static char const header_magic[8] = { 'V', 'S', 'N', 'R', 'F', 'B', '\0', '\0' };
+
+static size_t round_up(size_t size)
+{
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// shm_render_target
+//
+
+shm_render_target::~shm_render_target()
+{
+    close();
+}
+
+bool shm_render_target::open(std::string const& name, bool share_accum, int w, int h)
+{
+    close();
+
+    name_        = name;
+    share_accum_ = share_accum;
+    width_       = w;
+    height_      = h;
+
+    return create();
+}
+
+void shm_render_target::close()
+{
+    retire();
+    accum_.clear();
+    name_.clear();
+}
+
+bool shm_render_target::is_open() const
+{
+    return header_ != nullptr;
+}
+
+int shm_render_target::width() const
+{
+    return width_;
+}
+
+int shm_render_target::height() const
+{
+    return height_;
+}
+
+shm_render_target::color_type* shm_render_target::color()
+{
+    return reinterpret_cast<color_type*>(static_cast<char*>(segment_) + header_->color_offset);
+}
+
+shm_render_target::depth_type* shm_render_target::depth()
+{
+    return nullptr;
+}
+
+shm_render_target::accum_type* shm_render_target::accum()
+{
+    if (share_accum_)
+    {
+        return reinterpret_cast<accum_type*>(static_cast<char*>(segment_) + header_->accum_offset);
+    }
+
+    return accum_.data();
+}
+
+shm_render_target::ref_type shm_render_target::ref()
+{
+    return ref_type(color(), depth(), accum(), width(), height());
+}
+
+void shm_render_target::clear_color_buffer(vec4 const& c)
+{
+    size_t count = size_t(width_) * height_;
+
+    begin_frame();
+
+    std::fill(color(), color() + count, color_type(c));
+    std::fill(accum(), accum() + count, accum_type(c));
+
+    header_->frame.store(0, std::memory_order_relaxed);
+
+    // end_frame() would count a frame
+    header_->sequence.fetch_add(1, std::memory_order_release);
+}
+
+void shm_render_target::begin_frame()
+{
+    header_->sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void shm_render_target::end_frame()
+{
+    header_->frame.fetch_add(1, std::memory_order_relaxed);
+    header_->sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool shm_render_target::resize(int w, int h)
+{
+    if (w == width_ && h == height_ && is_open())
+    {
+        return true;
+    }
+
+    retire();
+
+    width_  = w;
+    height_ = h;
+
+    return create();
+}
+
+bool shm_render_target::create()
+{
+    size_t count = size_t(width_) * height_;
+    size_t color_size = round_up(count * sizeof(color_type));
+    size_t accum_size = share_accum_ ? round_up(count * sizeof(accum_type)) : 0;
+
+    segment_size_ = page_size + color_size + accum_size;
+
+    // Replace a stale segment of the same name (readers keep their mapping)
+    shm_unlink(name_.c_str());
+
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(segment_size_)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    void* ptr = mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    segment_ = ptr;
+
+    // The segment is zero-filled, i.e. black and sequence 0
+    header_ = new (segment_) shm_framebuffer_header;
+    std::memcpy(header_->magic, header_magic, sizeof(header_magic));
+    header_->version      = header_version;
+    header_->header_size  = sizeof(shm_framebuffer_header);
+    header_->width        = static_cast<uint32_t>(width_);
+    header_->height       = static_cast<uint32_t>(height_);
+    header_->color_format = PF_RGBA8;
+    header_->accum_format = share_accum_ ? PF_RGBA32F : 0;
+    header_->color_offset = page_size;
+    header_->accum_offset = share_accum_ ? page_size + color_size : 0;
+    header_->segment_size = segment_size_;
+    header_->sequence.store(0, std::memory_order_relaxed);
+    header_->frame.store(0, std::memory_order_relaxed);
+    header_->retired.store(0, std::memory_order_release);
+
+    if (!share_accum_)
+    {
+        accum_.resize(count);
+    }
+
+    return true;
+}
+
+void shm_render_target::retire()
+{
+    if (header_ == nullptr)
+    {
+        return;
+    }
+
+    header_->retired.store(1, std::memory_order_release);
+
+    munmap(segment_, segment_size_);
+    shm_unlink(name_.c_str());
+
+    segment_      = nullptr;
+    segment_size_ = 0;
+    header_       = nullptr;
+}
+
+} // namespace visionaray
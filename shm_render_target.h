@@ -0,0 +1,123 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <visionaray/aligned_vector.h>
+#include <visionaray/math/math.h>
+#include <visionaray/pixel_format.h>
+#include <visionaray/simple_buffer_rt.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Header at the start of the shared-memory segment
+//
+// The segment holds the header (one page), the RGBA8 color buffer (row-major,
+// bottom row first) and, if accum_format != 0, the linear RGBA32F
+// accumulation buffer. Offsets are in bytes from the start of the segment.
+//
+// sequence is a seqlock: it is odd while a frame is being rendered and even
+// otherwise. A reader that needs a complete frame reads sequence (and retries
+// while it is odd), reads the pixels and accepts them if sequence has not
+// changed. Progressive viewers may also read at any time and accept pixels
+// from two consecutive accumulation frames. frame counts the accumulated
+// frames since the last reset. When the renderer resizes or exits, it sets
+// retired and unlinks the segment; readers should then unmap and reopen it
+//
+
+struct shm_framebuffer_header
+{
+    char                    magic[8];       // "VSNRFB\0\0"
+    uint32_t                version;
+    uint32_t                header_size;
+    uint32_t                width;
+    uint32_t                height;
+    uint32_t                color_format;   // visionaray::pixel_format (PF_RGBA8)
+    uint32_t                accum_format;   // PF_RGBA32F or 0 if not shared
+    uint64_t                color_offset;
+    uint64_t                accum_offset;
+    uint64_t                segment_size;
+    std::atomic<uint64_t>   sequence;
+    std::atomic<uint64_t>   frame;
+    std::atomic<uint32_t>   retired;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+
+//-------------------------------------------------------------------------------------------------
+// Render target with its color buffer (and optionally the accumulation
+// buffer) in a POSIX shared-memory segment. Drop-in for simple_buffer_rt
+// with the scheduler
+//
+
+class shm_render_target
+{
+public:
+
+    // Same buffer formats as the renderer's simple_buffer_rt
+    using buffer_rt  = simple_buffer_rt<PF_RGBA8, PF_UNSPECIFIED, PF_RGBA32F>;
+    using ref_type   = buffer_rt::ref_type;
+    using color_type = buffer_rt::color_type;
+    using depth_type = buffer_rt::depth_type;
+    using accum_type = buffer_rt::accum_type;
+
+public:
+
+    shm_render_target() = default;
+   ~shm_render_target();
+
+    shm_render_target(shm_render_target const&) = delete;
+    shm_render_target& operator=(shm_render_target const&) = delete;
+
+    // Create segment name (POSIX shm name, "/name") for w x h pixels. With
+    // share_accum the accumulation buffer is placed in the segment, too
+    bool open(std::string const& name, bool share_accum, int w, int h);
+    void close();
+
+    bool is_open() const;
+
+    int width() const;
+    int height() const;
+
+    color_type* color();
+    depth_type* depth();
+    accum_type* accum();
+
+    ref_type ref();
+
+    // Reset accumulation (frame counter and buffers)
+    void clear_color_buffer(vec4 const& c = vec4(0.0f));
+
+    void begin_frame();
+    void end_frame();
+
+    // Recreate the segment with the new size, the old segment is retired
+    bool resize(int w, int h);
+
+private:
+
+    std::string                 name_;
+    bool                        share_accum_    = false;
+    int                         width_          = 0;
+    int                         height_         = 0;
+
+    void*                       segment_        = nullptr;
+    size_t                      segment_size_   = 0;
+    shm_framebuffer_header*     header_         = nullptr;
+
+    // Accumulation buffer if not shared
+    aligned_vector<accum_type>  accum_;
+
+    bool create();
+    void retire();
+
+};
+
+} // namespace visionaray
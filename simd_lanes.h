@@ -0,0 +1,83 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include <visionaray/math/math.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Per-lane access to SIMD values, T = float or int (N = 1) or a SIMD type
+//
+
+template <typename T>
+using lane_type = std::conditional_t<
+        std::is_integral<simd::element_type_t<T>>::value,
+        int,
+        float
+        >;
+
+template <typename T>
+using lane_array = std::array<lane_type<T>, simd::num_elements<T>::value>;
+
+template <typename T>
+inline void store_lanes(lane_array<T>& dst, T const& value)
+{
+    if constexpr (simd::num_elements<T>::value == 1)
+    {
+        dst[0] = value;
+    }
+    else
+    {
+        alignas(64) lane_array<T> tmp;
+        store(tmp.data(), value);
+        dst = tmp;
+    }
+}
+
+template <typename T>
+inline T load_lanes(lane_array<T> const& src)
+{
+    if constexpr (simd::num_elements<T>::value == 1)
+    {
+        return src[0];
+    }
+    else
+    {
+        alignas(64) lane_array<T> tmp = src;
+        return T(tmp.data());
+    }
+}
+
+// Lanes of mask as 0/1 floats
+template <typename S>
+inline lane_array<S> mask_lanes(simd::mask_type_t<S> const& mask)
+{
+    lane_array<S> result;
+    store_lanes<S>(result, select(mask, S(1.0), S(0.0)));
+    return result;
+}
+
+template <typename S>
+inline simd::mask_type_t<S> lanes_to_mask(lane_array<S> const& lanes)
+{
+    return load_lanes<S>(lanes) != S(0.0);
+}
+
+template <typename S>
+inline int count_lanes(simd::mask_type_t<S> const& mask)
+{
+    int result = 0;
+    for (auto l : mask_lanes<S>(mask))
+    {
+        result += l != 0.0f;
+    }
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,391 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_io.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+static bool make_unix_address(std::string const& path, sockaddr_un& addr)
+{
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    {
+        return false;
+    }
+
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+static addrinfo* resolve(std::string const& address, bool passive)
+{
+    size_t colon = address.find_last_of(':');
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = passive ? AI_PASSIVE : 0;
+
+    bool any = host.empty() || host == "*";
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(any ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0)
+    {
+        return nullptr;
+    }
+
+    return result;
+}
+
+static void configure_tcp(int fd)
+{
+    // Small messages (assignments) must not wait for Nagle, dead peers are
+    // detected by keepalive
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+bool is_tcp_address(std::string const& address)
+{
+    size_t colon = address.find_last_of(':');
+
+    return colon != std::string::npos
+        && colon + 1 < address.size()
+        && address.find('/') == std::string::npos;
+}
+
+int listen_socket(std::string const& address)
+{
+    if (!is_tcp_address(address))
+    {
+        sockaddr_un addr;
+        if (!make_unix_address(address, addr))
+        {
+            return -1;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        unlink(address.c_str());
+
+        // Owner only, connections are refused until listen()
+        if (bind(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) != 0
+         || chmod(address.c_str(), S_IRUSR | S_IWUSR) != 0
+         || listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    addrinfo* list = resolve(address, true);
+
+    int fd = -1;
+
+    for (addrinfo* ai = list; ai != nullptr && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (list != nullptr)
+    {
+        freeaddrinfo(list);
+    }
+
+    return fd;
+}
+
+int connect_socket(std::string const& address)
+{
+    if (!is_tcp_address(address))
+    {
+        sockaddr_un addr;
+        if (!make_unix_address(address, addr))
+        {
+            return -1;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        if (connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    addrinfo* list = resolve(address, false);
+
+    int fd = -1;
+
+    for (addrinfo* ai = list; ai != nullptr && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+
+        configure_tcp(fd);
+    }
+
+    if (list != nullptr)
+    {
+        freeaddrinfo(list);
+    }
+
+    return fd;
+}
+
+int accept_socket(int listen_fd)
+{
+    sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+
+    int fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len, SOCK_CLOEXEC);
+
+    if (fd >= 0 && (addr.ss_family == AF_INET || addr.ss_family == AF_INET6))
+    {
+        configure_tcp(fd);
+    }
+
+    return fd;
+}
+
+void remove_socket_file(std::string const& address)
+{
+    if (!is_tcp_address(address))
+    {
+        unlink(address.c_str());
+    }
+}
+
+bool send_all(int fd, void const* data, size_t size)
+{
+    auto ptr = static_cast<char const*>(data);
+
+    while (size > 0)
+    {
+        ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        ptr  += n;
+        size -= static_cast<size_t>(n);
+    }
+
+    return true;
+}
+
+bool send_all(int fd, std::initializer_list<send_buffer> buffers)
+{
+    std::vector<iovec> iov;
+
+    for (auto const& b : buffers)
+    {
+        if (b.size > 0)
+        {
+            iov.push_back({ const_cast<void*>(b.data), b.size });
+        }
+    }
+
+    size_t first = 0;
+
+    while (first < iov.size())
+    {
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = iov.data() + first;
+        msg.msg_iovlen = std::min<size_t>(iov.size() - first, IOV_MAX);
+
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        // Skip what was sent, partially sent buffers are continued
+        auto sent = static_cast<size_t>(n);
+
+        while (first < iov.size() && sent >= iov[first].iov_len)
+        {
+            sent -= iov[first].iov_len;
+            ++first;
+        }
+
+        if (sent > 0)
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + sent;
+            iov[first].iov_len -= sent;
+        }
+    }
+
+    return true;
+}
+
+bool recv_all(int fd, void* data, size_t size, socket_deadline deadline)
+{
+    auto ptr = static_cast<char*>(data);
+
+    while (size > 0)
+    {
+        if (deadline != socket_deadline::max())
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()
+                    );
+
+            pollfd p = { fd, POLLIN, 0 };
+            int r = remaining.count() > 0 ? poll(&p, 1, static_cast<int>(std::min<long long>(remaining.count(), 1 << 30))) : 0;
+
+            if (r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (r <= 0)
+            {
+                errno = r == 0 ? ETIMEDOUT : errno;
+                return false;
+            }
+        }
+
+        ssize_t n = recv(fd, ptr, size, 0);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        ptr  += n;
+        size -= static_cast<size_t>(n);
+    }
+
+    return true;
+}
+
+bool recv_line(int fd, std::string& buffer, std::string& line, size_t max_length)
+{
+    for (;;)
+    {
+        size_t newline = buffer.find('\n');
+
+        if (newline != std::string::npos)
+        {
+            line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+
+            return true;
+        }
+
+        if (buffer.size() > max_length)
+        {
+            return false;
+        }
+
+        char chunk[4096];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+} // namespace visionaray
@@ -0,0 +1,58 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Blocking stream sockets
+//
+// Addresses of the form host:port (host may be empty or * for listening on
+// all interfaces) are TCP, everything else is a Unix domain socket path.
+// Functions return -1 or false on failure
+//
+
+bool is_tcp_address(std::string const& address);
+
+// Replaces a stale socket file for Unix domain sockets, which are only
+// accessible by the owner (mode 0600)
+int listen_socket(std::string const& address);
+
+int connect_socket(std::string const& address);
+
+// accept() a connection, TCP connections are configured like the ones
+// from connect_socket() (no Nagle delay, keepalive)
+int accept_socket(int listen_fd);
+
+// Remove the socket file of a Unix domain socket, no-op for TCP
+void remove_socket_file(std::string const& address);
+
+// Does not raise SIGPIPE if the peer hung up
+bool send_all(int fd, void const* data, size_t size);
+
+// Sends the buffers back to back with as few writes as possible, e.g. a
+// message header and its payload
+struct send_buffer
+{
+    void const* data;
+    size_t      size;
+};
+
+bool send_all(int fd, std::initializer_list<send_buffer> buffers);
+
+// Fails once deadline has passed, time_point::max() waits forever
+using socket_deadline = std::chrono::steady_clock::time_point;
+
+bool recv_all(int fd, void* data, size_t size, socket_deadline deadline = socket_deadline::max());
+
+// Next '\n' terminated line (without "\r\n"), buffer keeps what was read
+// beyond it. Fails for lines longer than max_length
+bool recv_line(int fd, std::string& buffer, std::string& line, size_t max_length);
+
+} // namespace visionaray
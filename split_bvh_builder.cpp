@@ -0,0 +1,571 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <visionaray/math/math.h>
+
+#include "split_bvh_builder.h"
+#include "triangle_reference.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+namespace
+{
+
+enum { NumObjectBins = 16, NumSpatialBins = 32, MaxDepth = 64 };
+
+using reference = triangle_reference;
+
+struct object_bin
+{
+    aabb     bounds;
+    unsigned count = 0;
+
+    object_bin() { bounds.invalidate(); }
+};
+
+struct spatial_bin
+{
+    aabb     bounds;
+    unsigned enter = 0;
+    unsigned exit  = 0;
+
+    spatial_bin() { bounds.invalidate(); }
+};
+
+struct split_candidate
+{
+    float    cost = std::numeric_limits<float>::max();
+    int      axis = -1;
+    int      bin  = 0;      // object splits: first bin on the right side
+    float    pos  = 0.0f;   // spatial splits: split plane
+    aabb     left;
+    aabb     right;
+    unsigned left_count  = 0;
+    unsigned right_count = 0;
+};
+
+inline bool is_empty(aabb const& box)
+{
+    return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+
+inline float half_surface_area(aabb const& box)
+{
+    if (is_empty(box))
+    {
+        return 0.0f;
+    }
+
+    vec3 s = box.max - box.min;
+    return s.x * s.y + s.y * s.z + s.z * s.x;
+}
+
+inline aabb intersection(aabb const& a, aabb const& b)
+{
+    return aabb(max(a.min, b.min), min(a.max, b.max));
+}
+
+inline aabb empty_box()
+{
+    aabb result;
+    result.invalidate();
+    return result;
+}
+
+inline int object_bin_index(float c, float min_c, float scale)
+{
+    int result = static_cast<int>((c - min_c) * scale);
+    return std::min(std::max(result, 0), int(NumObjectBins) - 1);
+}
+
+inline int spatial_bin_index(float p, float min_p, float inv_bin_size)
+{
+    int result = static_cast<int>((p - min_p) * inv_bin_size);
+    return std::min(std::max(result, 0), int(NumSpatialBins) - 1);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Build state
+//
+
+struct build_context
+{
+    model::triangle_type const* primitives;
+    aligned_vector<bvh_node>&   nodes;
+    aligned_vector<unsigned>&   indices;
+
+    float                       root_half_area;
+    size_t                      max_references;
+    size_t                      total_references;
+
+    float                       alpha;
+    size_t                      min_split_references;
+    size_t                      max_leaf_size;
+
+    split_bvh_builder::stats_type& stats;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Binned SAH over reference centroids
+//
+
+split_candidate find_object_split(std::vector<reference> const& refs, aabb const& centroid_bounds)
+{
+    split_candidate result;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        float scale = NumObjectBins / extent;
+
+        object_bin bins[NumObjectBins];
+
+        for (auto const& ref : refs)
+        {
+            int b = object_bin_index(ref.bounds.center()[axis], centroid_bounds.min[axis], scale);
+            bins[b].bounds.insert(ref.bounds);
+            ++bins[b].count;
+        }
+
+        // Sweep from the right
+        aabb     right_bounds[NumObjectBins];
+        unsigned right_count[NumObjectBins];
+
+        aabb box = empty_box();
+        unsigned count = 0;
+
+        for (int i = NumObjectBins - 1; i > 0; --i)
+        {
+            box.insert(bins[i].bounds);
+            count += bins[i].count;
+            right_bounds[i] = box;
+            right_count[i] = count;
+        }
+
+        // Sweep from the left
+        box = empty_box();
+        count = 0;
+
+        for (int i = 1; i < NumObjectBins; ++i)
+        {
+            box.insert(bins[i - 1].bounds);
+            count += bins[i - 1].count;
+
+            if (count == 0 || right_count[i] == 0)
+            {
+                continue;
+            }
+
+            float cost = half_surface_area(box) * count
+                       + half_surface_area(right_bounds[i]) * right_count[i];
+
+            if (cost < result.cost)
+            {
+                result.cost        = cost;
+                result.axis        = axis;
+                result.bin         = i;
+                result.left        = box;
+                result.right       = right_bounds[i];
+                result.left_count  = count;
+                result.right_count = right_count[i];
+            }
+        }
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Binned SAH over chopped references
+//
+
+split_candidate find_spatial_split(
+        build_context const&            ctx,
+        std::vector<reference> const&   refs,
+        aabb const&                     bounds
+        )
+{
+    split_candidate result;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = bounds.max[axis] - bounds.min[axis];
+
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        float bin_size = extent / NumSpatialBins;
+        float inv_bin_size = 1.0f / bin_size;
+
+        spatial_bin bins[NumSpatialBins];
+
+        for (auto const& ref : refs)
+        {
+            int first = spatial_bin_index(ref.bounds.min[axis], bounds.min[axis], inv_bin_size);
+            int last  = spatial_bin_index(ref.bounds.max[axis], bounds.min[axis], inv_bin_size);
+
+            reference current = ref;
+
+            for (int b = first; b < last; ++b)
+            {
+                reference l;
+                reference r;
+                split_reference(current, ctx.primitives[ref.prim], axis, bounds.min[axis] + bin_size * (b + 1), l, r);
+
+                // Clipped parts can be empty if the triangle only touches
+                // ref.bounds, they must not grow the bins
+                if (!is_empty(l.bounds))
+                {
+                    bins[b].bounds.insert(l.bounds);
+                }
+
+                current = r;
+            }
+
+            if (!is_empty(current.bounds))
+            {
+                bins[last].bounds.insert(current.bounds);
+            }
+            ++bins[first].enter;
+            ++bins[last].exit;
+        }
+
+        // Sweep from the right
+        aabb     right_bounds[NumSpatialBins];
+        unsigned right_count[NumSpatialBins];
+
+        aabb box = empty_box();
+        unsigned count = 0;
+
+        for (int i = NumSpatialBins - 1; i > 0; --i)
+        {
+            box.insert(bins[i].bounds);
+            count += bins[i].exit;
+            right_bounds[i] = box;
+            right_count[i] = count;
+        }
+
+        // Sweep from the left
+        box = empty_box();
+        count = 0;
+
+        for (int i = 1; i < NumSpatialBins; ++i)
+        {
+            box.insert(bins[i - 1].bounds);
+            count += bins[i - 1].enter;
+
+            if (count == 0 || right_count[i] == 0)
+            {
+                continue;
+            }
+
+            float cost = half_surface_area(box) * count
+                       + half_surface_area(right_bounds[i]) * right_count[i];
+
+            if (cost < result.cost)
+            {
+                result.cost        = cost;
+                result.axis        = axis;
+                result.pos         = bounds.min[axis] + bin_size * i;
+                result.left        = box;
+                result.right       = right_bounds[i];
+                result.left_count  = count;
+                result.right_count = right_count[i];
+            }
+        }
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Distribute references, straddling references are split or, if that is
+// cheaper, "unsplit" and moved to one side entirely
+//
+
+void partition_spatial(
+        build_context const&            ctx,
+        std::vector<reference> const&   refs,
+        split_candidate const&          split,
+        std::vector<reference>&         left,
+        std::vector<reference>&         right
+        )
+{
+    aabb left_bounds = split.left;
+    aabb right_bounds = split.right;
+    float left_count = static_cast<float>(split.left_count);
+    float right_count = static_cast<float>(split.right_count);
+
+    for (auto const& ref : refs)
+    {
+        if (ref.bounds.max[split.axis] <= split.pos)
+        {
+            left.push_back(ref);
+        }
+        else if (ref.bounds.min[split.axis] >= split.pos)
+        {
+            right.push_back(ref);
+        }
+        else
+        {
+            aabb lu = combine(left_bounds, ref.bounds);
+            aabb ru = combine(right_bounds, ref.bounds);
+
+            float cost_split = half_surface_area(left_bounds) * left_count
+                             + half_surface_area(right_bounds) * right_count;
+            float cost_left  = half_surface_area(lu) * left_count
+                             + half_surface_area(right_bounds) * (right_count - 1.0f);
+            float cost_right = half_surface_area(left_bounds) * (left_count - 1.0f)
+                             + half_surface_area(ru) * right_count;
+
+            if (cost_left < cost_split && cost_left <= cost_right)
+            {
+                left.push_back(ref);
+                left_bounds = lu;
+                right_count -= 1.0f;
+            }
+            else if (cost_right < cost_split)
+            {
+                right.push_back(ref);
+                right_bounds = ru;
+                left_count -= 1.0f;
+            }
+            else
+            {
+                reference l;
+                reference r;
+                split_reference(ref, ctx.primitives[ref.prim], split.axis, split.pos, l, r);
+
+                // The part of the triangle inside ref.bounds may lie on one
+                // side only, then that side gets all of it
+                if (is_empty(l.bounds))
+                {
+                    right.push_back(r);
+                    left_count -= 1.0f;
+                }
+                else if (is_empty(r.bounds))
+                {
+                    left.push_back(l);
+                    right_count -= 1.0f;
+                }
+                else
+                {
+                    left.push_back(l);
+                    right.push_back(r);
+                }
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Recursive build
+//
+
+void make_leaf(build_context& ctx, unsigned node_index, std::vector<reference> const& refs, aabb const& bounds)
+{
+    auto first = static_cast<unsigned>(ctx.indices.size());
+
+    for (auto const& ref : refs)
+    {
+        ctx.indices.push_back(ref.prim);
+    }
+
+    set_leaf(ctx.nodes[node_index], bounds, first, static_cast<unsigned>(refs.size()));
+}
+
+void build_node(build_context& ctx, unsigned node_index, std::vector<reference>&& refs, aabb const& bounds, int depth)
+{
+    if (refs.size() <= ctx.max_leaf_size || depth >= MaxDepth)
+    {
+        make_leaf(ctx, node_index, refs, bounds);
+        return;
+    }
+
+    aabb centroid_bounds = empty_box();
+    for (auto const& ref : refs)
+    {
+        centroid_bounds.insert(ref.bounds.center());
+    }
+
+    auto object = find_object_split(refs, centroid_bounds);
+
+    std::vector<reference> left;
+    std::vector<reference> right;
+
+    bool use_spatial = false;
+
+    // Only look for spatial splits where object splits overlap significantly
+    if (ctx.max_references > ctx.total_references && refs.size() >= ctx.min_split_references)
+    {
+        float overlap = object.axis >= 0
+                ? half_surface_area(intersection(object.left, object.right))
+                : half_surface_area(bounds);
+
+        if (overlap > ctx.alpha * ctx.root_half_area)
+        {
+            auto spatial = find_spatial_split(ctx, refs, bounds);
+
+            if (spatial.axis >= 0 && spatial.cost < object.cost)
+            {
+                size_t duplicates = spatial.left_count + spatial.right_count - refs.size();
+
+                if (ctx.total_references + duplicates <= ctx.max_references)
+                {
+                    partition_spatial(ctx, refs, spatial, left, right);
+
+                    // Unsplitting may have moved all references to one side
+                    use_spatial = !left.empty() && !right.empty();
+
+                    if (use_spatial)
+                    {
+                        ctx.total_references += left.size() + right.size() - refs.size();
+                        ++ctx.stats.num_spatial_splits;
+                    }
+                    else
+                    {
+                        left.clear();
+                        right.clear();
+                    }
+                }
+                else
+                {
+                    ++ctx.stats.num_budget_rejects;
+                }
+            }
+        }
+    }
+
+    if (!use_spatial)
+    {
+        if (object.axis >= 0)
+        {
+            float scale = NumObjectBins / (centroid_bounds.max[object.axis] - centroid_bounds.min[object.axis]);
+
+            for (auto const& ref : refs)
+            {
+                int b = object_bin_index(ref.bounds.center()[object.axis], centroid_bounds.min[object.axis], scale);
+                (b < object.bin ? left : right).push_back(ref);
+            }
+        }
+        else
+        {
+            // All centroids coincide, split in the middle
+            auto mid = refs.begin() + refs.size() / 2;
+            left.assign(refs.begin(), mid);
+            right.assign(mid, refs.end());
+        }
+
+        ++ctx.stats.num_object_splits;
+    }
+
+    // Release memory before descending
+    std::vector<reference>().swap(refs);
+
+    aabb left_bounds = empty_box();
+    for (auto const& ref : left)
+    {
+        left_bounds.insert(ref.bounds);
+    }
+
+    aabb right_bounds = empty_box();
+    for (auto const& ref : right)
+    {
+        right_bounds.insert(ref.bounds);
+    }
+
+    auto first_child = static_cast<unsigned>(ctx.nodes.size());
+    ctx.nodes.resize(ctx.nodes.size() + 2);
+    set_inner(ctx.nodes[node_index], bounds, first_child);
+
+    build_node(ctx, first_child, std::move(left), left_bounds, depth + 1);
+    build_node(ctx, first_child + 1, std::move(right), right_bounds, depth + 1);
+}
+
+} // namespace
+
+
+//-------------------------------------------------------------------------------------------------
+// split_bvh_builder
+//
+
+split_bvh_builder::tree_type split_bvh_builder::build(model::triangle_type const* primitives, size_t num_prims)
+{
+    stats_ = stats_type();
+    stats_.num_primitives = num_prims;
+
+    tree_type tree(primitives, num_prims);
+
+    aligned_vector<bvh_node> nodes;
+    aligned_vector<unsigned> indices;
+
+    if (num_prims == 0)
+    {
+        tree.nodes() = std::move(nodes);
+        tree.indices() = std::move(indices);
+        return tree;
+    }
+
+    std::vector<reference> refs(num_prims);
+
+    aabb bounds = empty_box();
+
+    for (size_t i = 0; i < num_prims; ++i)
+    {
+        refs[i] = make_reference(primitives[i], static_cast<unsigned>(i));
+        bounds.insert(refs[i].bounds);
+    }
+
+    // Rough upper bound, avoids most reallocations
+    nodes.reserve(2 * num_prims);
+    nodes.resize(1);
+    indices.reserve(num_prims);
+
+    build_context ctx{
+            primitives,
+            nodes,
+            indices,
+            half_surface_area(bounds),
+            static_cast<size_t>(std::max(max_duplication_, 1.0f) * num_prims),
+            num_prims,
+            alpha_,
+            std::max(min_split_references_, size_t(2)),
+            std::max(max_leaf_size_, size_t(1)),
+            stats_
+            };
+
+    build_node(ctx, 0, std::move(refs), bounds, 0);
+
+    stats_.num_references = indices.size();
+
+    tree.nodes() = std::move(nodes);
+    tree.indices() = std::move(indices);
+
+    return tree;
+}
+
+} // namespace visionaray
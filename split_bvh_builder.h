@@ -0,0 +1,76 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+
+#include <visionaray/bvh.h>
+
+#include <common/model.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Binned SAH builder with spatial splits (Stich et al. 2009) and an explicit
+// memory budget. In contrast to binned_sah_builder::enable_spatial_splits(),
+// reference duplication is bounded by max_duplication, spatial splits are
+// only attempted where the best object split overlaps by more than alpha,
+// and only for nodes with at least min_split_references references
+//
+
+class split_bvh_builder
+{
+public:
+
+    using tree_type = index_bvh<model::triangle_type>;
+
+    struct stats_type
+    {
+        size_t num_primitives       = 0;
+        size_t num_references       = 0;
+        size_t num_spatial_splits   = 0;
+        size_t num_object_splits    = 0;
+
+        // Spatial splits that would have been taken but exceeded the budget
+        size_t num_budget_rejects   = 0;
+
+        // References / input primitives
+        float duplication() const
+        {
+            return num_primitives > 0 ? num_references / static_cast<float>(num_primitives) : 1.0f;
+        }
+    };
+
+public:
+
+    // Maximum number of references relative to the number of input primitives.
+    // 1.0 disables spatial splits
+    void set_max_duplication(float factor) { max_duplication_ = factor; }
+
+    // Only attempt spatial splits where the children of the best object split
+    // overlap by more than alpha times the surface area of the root node
+    void set_alpha(float alpha) { alpha_ = alpha; }
+
+    // Only attempt spatial splits for nodes with at least that many references
+    void set_min_split_references(size_t count) { min_split_references_ = count; }
+
+    void set_max_leaf_size(size_t count) { max_leaf_size_ = count; }
+
+    tree_type build(model::triangle_type const* primitives, size_t num_prims);
+
+    // Duplication etc. actually produced by the last build()
+    stats_type const& stats() const { return stats_; }
+
+private:
+
+    float       max_duplication_        = 2.0f;
+    float       alpha_                  = 1.0e-5f;
+    size_t      min_split_references_   = 8;
+    size_t      max_leaf_size_          = 4;
+
+    stats_type  stats_;
+
+};
+
+} // namespace visionaray
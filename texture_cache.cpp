@@ -0,0 +1,490 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <common/image.h>
+
+#include "texture_cache.h"
+#include "texture_convert.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// File format
+//
+
+namespace
+{
+
+static constexpr uint32_t file_version = 1;
+static constexpr uint64_t page_bytes = mip_texture::PageTexels * sizeof(uint32_t);
+static char const file_magic[8] = { 'V', 'S', 'N', 'R', 'T', 'E', 'X', '\0' };
+
+struct file_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t page_size;         // texels per page edge
+    uint64_t num_textures;
+    uint64_t num_pages;
+    uint64_t pages_offset;
+    uint64_t table_offset;      // texture table, see write()
+};
+
+struct file_level
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pages_x;
+    uint32_t padding;
+    uint64_t first_page;
+};
+
+struct page_entry
+{
+    std::atomic<uint32_t*>  data{nullptr};
+    std::atomic<uint64_t>   last_use{0};
+};
+
+// Pages are read under one of these locks, selected by page index
+static constexpr size_t num_locks = 64;
+
+// pread() until size bytes are read, false on errors and end of file
+inline bool read_at(int fd, void* data, size_t size, off_t offset)
+{
+    auto ptr = static_cast<char*>(data);
+
+    while (size > 0)
+    {
+        ssize_t n = ::pread(fd, ptr, size, offset);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        ptr    += n;
+        size   -= static_cast<size_t>(n);
+        offset += n;
+    }
+
+    return true;
+}
+
+// Served (and not cached) for pages that cannot be read
+inline uint32_t const* error_page()
+{
+    static std::vector<uint32_t> const page(mip_texture::PageTexels, 0xFFFFFFFF);
+    return page.data();
+}
+
+} // namespace
+
+
+//-------------------------------------------------------------------------------------------------
+// Private implementation
+//
+
+struct texture_cache::impl
+{
+    int                             fd          = -1;
+    file_header                     header;
+
+    std::vector<std::string>        names;
+    std::vector<size_t>             first_pages;
+    std::vector<std::vector<mip_texture::level>> levels;
+
+    std::unique_ptr<page_entry[]>   pages;
+    std::mutex                      locks[num_locks];
+
+    size_t                          budget      = 0;
+    uint64_t                        frame       = 1;
+
+    std::atomic<uint64_t>           hits{0};
+    std::atomic<uint64_t>           misses{0};
+    std::atomic<uint64_t>           resident{0};
+    std::atomic<uint64_t>           read_errors{0};
+    uint64_t                        evictions   = 0;
+
+    // Page ranges of the texture table must lie inside the page area
+    bool valid_levels(uint64_t first_page, std::vector<mip_texture::level> const& levels) const
+    {
+        unsigned const P = mip_texture::PageSize;
+
+        if (levels.empty() || first_page > header.num_pages)
+        {
+            return false;
+        }
+
+        for (auto const& lvl : levels)
+        {
+            uint64_t pages_y = (uint64_t(lvl.height) + P - 1) / P;
+
+            if (lvl.width == 0 || lvl.height == 0
+             || lvl.pages_x != (uint64_t(lvl.width) + P - 1) / P
+             || lvl.first_page > header.num_pages - first_page
+             || lvl.pages_x * pages_y > header.num_pages - first_page - lvl.first_page)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// texture_cache
+//
+
+texture_cache::texture_cache() = default;
+
+texture_cache::~texture_cache()
+{
+    close();
+}
+
+bool texture_cache::write(std::string const& filename, std::vector<std::string> const& image_files)
+{
+    std::ofstream out(filename, std::ios::binary);
+
+    if (!out.good())
+    {
+        return false;
+    }
+
+    file_header header;
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version      = file_version;
+    header.page_size    = mip_texture::PageSize;
+    header.num_textures = 0;
+    header.num_pages    = 0;
+    header.pages_offset = page_bytes;
+    header.table_offset = 0;
+
+    // Pages first, the table is only known once all pyramids are written
+    std::vector<char> zeros(page_bytes);
+    out.write(zeros.data(), page_bytes);
+
+    std::vector<std::string> names;
+    std::vector<uint64_t> first_pages;
+    std::vector<std::vector<mip_texture::level>> levels;
+
+    for (auto const& file : image_files)
+    {
+        if (std::find(names.begin(), names.end(), file) != names.end())
+        {
+            continue;
+        }
+
+        image img;
+        if (!img.load(file))
+        {
+            std::cerr << "Warning: cannot load texture from file: " << file << '\n';
+            continue;
+        }
+
+        // One decoded image and its pyramid at a time
+        model::texture_type tex(img.width(), img.height());
+        make_texture_rgba8(tex, img);
+
+        mip_texture mip(
+                reinterpret_cast<uint8_t const*>(tex.data()),
+                static_cast<unsigned>(tex.width()),
+                static_cast<unsigned>(tex.height())
+                );
+
+        for (size_t p = 0; p < mip.num_pages(); ++p)
+        {
+            out.write(reinterpret_cast<char const*>(mip.page_data(p)), page_bytes);
+        }
+
+        names.push_back(file);
+        first_pages.push_back(header.num_pages);
+        levels.push_back(mip.levels());
+
+        header.num_pages += mip.num_pages();
+    }
+
+    // Texture table: per texture the name length and name, the number of
+    // levels, the first page and the levels
+    header.num_textures = names.size();
+    header.table_offset = header.pages_offset + header.num_pages * page_bytes;
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        uint32_t name_length = static_cast<uint32_t>(names[i].size());
+        uint32_t num_levels  = static_cast<uint32_t>(levels[i].size());
+        uint64_t first_page  = first_pages[i];
+
+        out.write(reinterpret_cast<char const*>(&name_length), sizeof(name_length));
+        out.write(names[i].data(), name_length);
+        out.write(reinterpret_cast<char const*>(&num_levels), sizeof(num_levels));
+        out.write(reinterpret_cast<char const*>(&first_page), sizeof(first_page));
+
+        for (auto const& lvl : levels[i])
+        {
+            file_level fl;
+            fl.width      = lvl.width;
+            fl.height     = lvl.height;
+            fl.pages_x    = lvl.pages_x;
+            fl.padding    = 0;
+            fl.first_page = lvl.first_page;
+            out.write(reinterpret_cast<char const*>(&fl), sizeof(fl));
+        }
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    return out.good();
+}
+
+bool texture_cache::open(std::string const& filename, size_t budget_bytes)
+{
+    close();
+
+    auto i = std::make_unique<impl>();
+
+    i->fd = ::open(filename.c_str(), O_RDONLY);
+    if (i->fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    auto const& header = i->header;
+
+    bool ok = fstat(i->fd, &st) == 0
+           && read_at(i->fd, &i->header, sizeof(i->header), 0)
+           && std::memcmp(header.magic, file_magic, sizeof(file_magic)) == 0
+           && header.version == file_version
+           && header.page_size == mip_texture::PageSize
+           && header.pages_offset <= header.table_offset
+           && header.num_pages <= (header.table_offset - header.pages_offset) / page_bytes
+           && header.table_offset <= static_cast<uint64_t>(st.st_size);
+
+    std::ifstream in(filename, std::ios::binary);
+    in.seekg(i->header.table_offset);
+
+    for (uint64_t t = 0; ok && t < i->header.num_textures; ++t)
+    {
+        uint32_t name_length = 0;
+        uint32_t num_levels = 0;
+        uint64_t first_page = 0;
+
+        in.read(reinterpret_cast<char*>(&name_length), sizeof(name_length));
+        std::string name(name_length, '\0');
+        in.read(&name[0], name_length);
+        in.read(reinterpret_cast<char*>(&num_levels), sizeof(num_levels));
+        in.read(reinterpret_cast<char*>(&first_page), sizeof(first_page));
+
+        std::vector<mip_texture::level> levels(num_levels);
+        for (auto& lvl : levels)
+        {
+            file_level fl;
+            in.read(reinterpret_cast<char*>(&fl), sizeof(fl));
+            lvl.width      = fl.width;
+            lvl.height     = fl.height;
+            lvl.pages_x    = fl.pages_x;
+            lvl.first_page = fl.first_page;
+        }
+
+        ok = in.good() && i->valid_levels(first_page, levels);
+
+        i->names.push_back(std::move(name));
+        i->first_pages.push_back(first_page);
+        i->levels.push_back(std::move(levels));
+    }
+
+    if (!ok)
+    {
+        std::cerr << "Warning: not a valid texture cache file: " << filename << '\n';
+        ::close(i->fd);
+        return false;
+    }
+
+    i->pages.reset(new page_entry[i->header.num_pages]);
+    i->budget = budget_bytes;
+
+    impl_ = std::move(i);
+
+    return true;
+}
+
+void texture_cache::close()
+{
+    if (!impl_)
+    {
+        return;
+    }
+
+    for (uint64_t p = 0; p < impl_->header.num_pages; ++p)
+    {
+        delete[] impl_->pages[p].data.load();
+    }
+
+    ::close(impl_->fd);
+
+    impl_.reset();
+}
+
+bool texture_cache::is_open() const
+{
+    return impl_ != nullptr;
+}
+
+size_t texture_cache::num_textures() const
+{
+    return impl_ ? impl_->names.size() : 0;
+}
+
+std::string const& texture_cache::texture_name(size_t i) const
+{
+    return impl_->names[i];
+}
+
+mip_texture texture_cache::texture(size_t i)
+{
+    return mip_texture(this, impl_->first_pages[i], impl_->levels[i]);
+}
+
+uint32_t const* texture_cache::page(size_t index)
+{
+    auto& entry = impl_->pages[index];
+    uint64_t frame = impl_->frame;
+
+    uint32_t* data = entry.data.load(std::memory_order_acquire);
+
+    if (data != nullptr)
+    {
+        // Only the first access in a frame is counted (and updates the LRU stamp)
+        if (entry.last_use.load(std::memory_order_relaxed) != frame)
+        {
+            entry.last_use.store(frame, std::memory_order_relaxed);
+            impl_->hits.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return data;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->locks[index % num_locks]);
+
+    data = entry.data.load(std::memory_order_acquire);
+
+    if (data == nullptr)
+    {
+        data = new uint32_t[mip_texture::PageTexels];
+
+        auto offset = static_cast<off_t>(impl_->header.pages_offset + index * page_bytes);
+
+        errno = 0;
+
+        if (!read_at(impl_->fd, data, page_bytes, offset))
+        {
+            // Not cached, the next access tries again
+            delete[] data;
+
+            if (impl_->read_errors.fetch_add(1, std::memory_order_relaxed) == 0)
+            {
+                std::cerr << "Error: cannot read texture cache page " << index << ": "
+                          << (errno != 0 ? std::strerror(errno) : "unexpected end of file") << '\n';
+            }
+
+            return error_page();
+        }
+
+        entry.last_use.store(frame, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_release);
+
+        impl_->misses.fetch_add(1, std::memory_order_relaxed);
+        impl_->resident.fetch_add(page_bytes, std::memory_order_relaxed);
+    }
+
+    return data;
+}
+
+void texture_cache::end_frame()
+{
+    if (!impl_)
+    {
+        return;
+    }
+
+    uint64_t resident = impl_->resident;
+
+    if (impl_->budget > 0 && resident > impl_->budget)
+    {
+        // Resident pages, least recently used first
+        std::vector<std::pair<uint64_t, uint64_t>> lru;
+
+        for (uint64_t p = 0; p < impl_->header.num_pages; ++p)
+        {
+            if (impl_->pages[p].data.load(std::memory_order_relaxed) != nullptr)
+            {
+                lru.emplace_back(impl_->pages[p].last_use.load(std::memory_order_relaxed), p);
+            }
+        }
+
+        std::sort(lru.begin(), lru.end());
+
+        for (auto const& l : lru)
+        {
+            if (resident <= impl_->budget)
+            {
+                break;
+            }
+
+            auto& entry = impl_->pages[l.second];
+            delete[] entry.data.exchange(nullptr);
+
+            resident -= page_bytes;
+            ++impl_->evictions;
+        }
+
+        impl_->resident = resident;
+    }
+
+    ++impl_->frame;
+}
+
+texture_cache::counters texture_cache::get_counters() const
+{
+    counters result;
+
+    if (impl_)
+    {
+        result.hits           = impl_->hits;
+        result.misses         = impl_->misses;
+        result.evictions      = impl_->evictions;
+        result.read_errors    = impl_->read_errors;
+        result.resident_bytes = impl_->resident;
+        result.total_bytes    = impl_->header.num_pages * page_bytes;
+        result.num_textures   = impl_->names.size();
+    }
+
+    return result;
+}
+
+} // namespace visionaray
@@ -0,0 +1,84 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mip_texture.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Tiled texture cache
+//
+// The mip pyramids of a set of image files are stored page by page (see
+// mip_texture) in a cache file. Pages are read on first access and evicted
+// least recently used when the resident size exceeds the budget. Pages are
+// only evicted in end_frame(), so pointers returned by page() stay valid
+// for the rest of the frame and the budget may be exceeded within a frame
+//
+
+class texture_cache
+{
+public:
+
+    struct counters
+    {
+        uint64_t hits           = 0;    // first access in a frame to a resident page
+        uint64_t misses         = 0;    // page reads
+        uint64_t evictions      = 0;
+        uint64_t read_errors    = 0;    // failed page reads, served as white pages
+        uint64_t resident_bytes = 0;
+        uint64_t total_bytes    = 0;
+        uint64_t num_textures   = 0;
+    };
+
+public:
+
+    texture_cache();
+   ~texture_cache();
+
+    texture_cache(texture_cache const&) = delete;
+    texture_cache& operator=(texture_cache const&) = delete;
+
+    // Decode the image files one at a time and write their pyramids. Files
+    // that cannot be decoded are skipped
+    static bool write(std::string const& filename, std::vector<std::string> const& image_files);
+
+    // Open cache file, budget_bytes == 0 disables eviction. Fails if the
+    // texture table references pages outside the file
+    bool open(std::string const& filename, size_t budget_bytes);
+    void close();
+
+    bool is_open() const;
+
+    size_t num_textures() const;
+
+    // Source image file of texture i
+    std::string const& texture_name(size_t i) const;
+
+    // Texture i, its pages are served by the cache
+    mip_texture texture(size_t i);
+
+    // Page by index in the file, read if not resident. Thread-safe. Pages
+    // that cannot be read are reported and served as white, uncached pages
+    uint32_t const* page(size_t index);
+
+    // Evict down to the budget, call between frames when no render thread is active
+    void end_frame();
+
+    counters get_counters() const;
+
+private:
+
+    struct impl;
+    std::unique_ptr<impl> impl_;
+
+};
+
+} // namespace visionaray
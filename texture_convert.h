@@ -0,0 +1,48 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <memory>
+
+#include <visionaray/math/unorm.h>
+#include <visionaray/math/vector.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/pixel_format.h>
+
+#include <common/image.h>
+#include <common/make_texture.h>
+
+#include "pixel_convert.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// make_texture() for RGBA8 textures that converts the image with the bulk
+// (parallel, SIMD) kernels from pixel_convert.h instead of texel by texel.
+// Formats without a kernel are left to make_texture()
+//
+
+template <typename Texture>
+inline void make_texture_rgba8(Texture& tex, image const& img)
+{
+    using value_type = typename Texture::value_type;
+    static_assert(sizeof(value_type) == 4, "Expected RGBA8 texels");
+
+    if (img.format() == PF_RGBA8 || !can_convert_pixels(PF_RGBA8, img.format()))
+    {
+        make_texture(tex, img);
+        return;
+    }
+
+    tex.set_address_mode(Wrap);
+    tex.set_filter_mode(Linear);
+    tex.set_color_space(sRGB);
+
+    // Down-convert to 8-bit, add alpha=1.0 if missing
+    std::unique_ptr<value_type[]> data(new value_type[img.width() * img.height()]);
+    convert_pixels(data.get(), PF_RGBA8, img.data(), img.format(), img.width() * img.height());
+    tex.reset(data.get());
+}
+
+} // namespace visionaray
@@ -0,0 +1,323 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "thread_affinity.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+// "0-3,8,10-11" -> { 0, 1, 2, 3, 8, 10, 11 }
+static std::vector<int> parse_cpu_list(std::string const& list)
+{
+    std::vector<int> cpus;
+    std::istringstream in(list);
+    std::string range;
+
+    while (std::getline(in, range, ','))
+    {
+        if (range.empty() || range == "\n")
+        {
+            continue;
+        }
+
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+
+        std::istringstream r(range);
+        r >> first;
+
+        if (r >> dash && dash == '-')
+        {
+            r >> last;
+        }
+        else
+        {
+            last = first;
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+static cpu_topology detect_topology()
+{
+    cpu_topology topo;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        for (int cpu = 0; cpu < static_cast<int>(std::thread::hardware_concurrency()); ++cpu)
+        {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    for (int node = 0; ; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+        if (!file.good())
+        {
+            // Node ids are dense in practice, stop at the first gap
+            break;
+        }
+
+        std::string list;
+        std::getline(file, list);
+
+        std::vector<int> cpus;
+        for (int cpu : parse_cpu_list(list))
+        {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        // Nodes without usable CPUs (memory only, or excluded by a cpuset)
+        if (!cpus.empty())
+        {
+            topo.node_cpus.push_back(cpus);
+        }
+    }
+
+    if (topo.node_cpus.empty())
+    {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        topo.node_cpus.push_back(cpus);
+    }
+
+    for (size_t node = 0; node < topo.node_cpus.size(); ++node)
+    {
+        for (int cpu : topo.node_cpus[node])
+        {
+            if (cpu >= static_cast<int>(topo.cpu_node.size()))
+            {
+                topo.cpu_node.resize(cpu + 1, -1);
+            }
+
+            topo.cpu_node[cpu] = static_cast<int>(node);
+        }
+    }
+
+    return topo;
+}
+
+static bool set_affinity(pid_t tid, std::vector<int> const& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+
+    return sched_setaffinity(tid, sizeof(set), &set) == 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Topology
+//
+
+cpu_topology const& get_cpu_topology()
+{
+    static cpu_topology const topo = detect_topology();
+    return topo;
+}
+
+size_t num_numa_nodes()
+{
+    return get_cpu_topology().node_cpus.size();
+}
+
+int current_numa_node()
+{
+    thread_local int node = -1;
+
+    if (node < 0)
+    {
+        auto const& topo = get_cpu_topology();
+        int cpu = sched_getcpu();
+
+        node = cpu >= 0 && cpu < static_cast<int>(topo.cpu_node.size()) ? std::max(topo.cpu_node[cpu], 0) : 0;
+    }
+
+    return node;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Pinning
+//
+
+std::vector<pid_t> list_threads()
+{
+    std::vector<pid_t> tids;
+
+    DIR* dir = opendir("/proc/self/task");
+
+    if (dir == nullptr)
+    {
+        return tids;
+    }
+
+    while (dirent* entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            tids.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+        }
+    }
+
+    closedir(dir);
+
+    std::sort(tids.begin(), tids.end());
+    return tids;
+}
+
+std::vector<pid_t> new_threads(std::vector<pid_t> const& before, std::vector<pid_t> const& after)
+{
+    std::vector<pid_t> result;
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(result));
+    return result;
+}
+
+size_t pin_threads(std::vector<pid_t> const& tids, affinity_policy policy, std::string& summary)
+{
+    auto const& topo = get_cpu_topology();
+    size_t num_nodes = topo.node_cpus.size();
+
+    // CPUs in the order threads are placed on them
+    std::vector<int> order;
+
+    if (policy == CompactAffinity)
+    {
+        for (auto const& cpus : topo.node_cpus)
+        {
+            order.insert(order.end(), cpus.begin(), cpus.end());
+        }
+    }
+    else
+    {
+        for (size_t i = 0; order.size() < topo.cpu_node.size(); ++i)
+        {
+            bool any = false;
+
+            for (auto const& cpus : topo.node_cpus)
+            {
+                if (i < cpus.size())
+                {
+                    order.push_back(cpus[i]);
+                    any = true;
+                }
+            }
+
+            if (!any)
+            {
+                break;
+            }
+        }
+    }
+
+    if (order.empty())
+    {
+        summary = "no CPUs";
+        return 0;
+    }
+
+    size_t pinned = 0;
+    std::vector<size_t> per_node(num_nodes, 0);
+
+    for (size_t i = 0; i < tids.size(); ++i)
+    {
+        // More threads than CPUs wrap around
+        int cpu = order[i % order.size()];
+        int node = topo.cpu_node[cpu];
+
+        bool ok = policy == NUMAAffinity
+                ? set_affinity(tids[i], topo.node_cpus[node])
+                : set_affinity(tids[i], { cpu });
+
+        if (ok)
+        {
+            ++pinned;
+            ++per_node[node];
+        }
+    }
+
+    std::ostringstream out;
+    out << num_nodes << " NUMA node(s), threads per node:";
+    for (size_t n : per_node)
+    {
+        out << ' ' << n;
+    }
+    summary = out.str();
+
+    return pinned;
+}
+
+void run_on_node(int node, std::function<void()> const& func)
+{
+    auto const& topo = get_cpu_topology();
+
+    std::thread t([&]()
+    {
+        if (node >= 0 && node < static_cast<int>(topo.node_cpus.size()))
+        {
+            set_affinity(0, topo.node_cpus[node]);
+        }
+
+        func();
+    });
+
+    t.join();
+}
+
+void release_pages(void* ptr, size_t size)
+{
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(ptr) + page - 1) / page * page;
+    uintptr_t last = (reinterpret_cast<uintptr_t>(ptr) + size) / page * page;
+
+    if (last > first)
+    {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+} // namespace visionaray
@@ -0,0 +1,79 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Thread placement policies
+//
+//  compact: one CPU per thread, filling a NUMA node before the next one
+//  scatter: one CPU per thread, round-robin over the NUMA nodes
+//  numa:    threads round-robin over the nodes, each free to run on all CPUs
+//           of its node; the BVH is replicated per node and framebuffer
+//           pages are first touched by the render threads
+//
+
+enum affinity_policy
+{
+    NoAffinity = 0,
+    CompactAffinity,
+    ScatterAffinity,
+    NUMAAffinity
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// CPU topology from /sys/devices/system/node, restricted to the CPUs this
+// process may run on. Machines without NUMA information are one node
+//
+
+struct cpu_topology
+{
+    // CPUs per node, ascending
+    std::vector<std::vector<int>> node_cpus;
+
+    // Node per CPU, -1 for CPUs not available
+    std::vector<int> cpu_node;
+};
+
+cpu_topology const& get_cpu_topology();
+
+size_t num_numa_nodes();
+
+// Node of the CPU the calling thread runs on (cached per thread)
+int current_numa_node();
+
+
+//-------------------------------------------------------------------------------------------------
+// Pinning
+//
+
+// Thread ids of this process
+std::vector<pid_t> list_threads();
+
+// Thread ids in after that are not in before, ascending
+std::vector<pid_t> new_threads(std::vector<pid_t> const& before, std::vector<pid_t> const& after);
+
+// Pin threads (in this order) according to policy. Returns the number of
+// threads pinned and a short summary
+size_t pin_threads(std::vector<pid_t> const& tids, affinity_policy policy, std::string& summary);
+
+// Run func on a thread bound to the CPUs of node and wait for it, so that
+// memory func allocates and writes is first touched on that node
+void run_on_node(int node, std::function<void()> const& func);
+
+// Drop the pages fully inside [ptr, ptr + size) so that they are allocated
+// again (zero-filled) on the node of the thread that touches them next.
+// Only valid for memory that is zero anyway
+void release_pages(void* ptr, size_t size);
+
+} // namespace visionaray
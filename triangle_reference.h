@@ -0,0 +1,93 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+#pragma once
+
+#include <algorithm>
+
+#include <visionaray/math/math.h>
+
+#include <common/model.h>
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Reference to (the part inside bounds of) a triangle, used by builders that
+// split triangles into several bounded references
+//
+
+struct triangle_reference
+{
+    aabb     bounds;
+    unsigned prim;
+};
+
+inline aabb get_bounds(triangle_reference const& ref)
+{
+    return ref.bounds;
+}
+
+inline triangle_reference make_reference(model::triangle_type const& tri, unsigned prim)
+{
+    triangle_reference result;
+    result.prim = prim;
+    result.bounds.invalidate();
+    result.bounds.insert(tri.v1);
+    result.bounds.insert(tri.v1 + tri.e1);
+    result.bounds.insert(tri.v1 + tri.e2);
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Split the part of a triangle that lies inside ref.bounds at an axis-aligned plane
+//
+
+inline void split_reference(
+        triangle_reference const&   ref,
+        model::triangle_type const& tri,
+        int                         axis,
+        float                       pos,
+        triangle_reference&         left,
+        triangle_reference&         right
+        )
+{
+    left.prim  = ref.prim;
+    right.prim = ref.prim;
+    left.bounds.invalidate();
+    right.bounds.invalidate();
+
+    vec3 verts[3] = { tri.v1, tri.v1 + tri.e1, tri.v1 + tri.e2 };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        vec3 const& a = verts[i];
+        vec3 const& b = verts[(i + 1) % 3];
+
+        if (a[axis] <= pos)
+        {
+            left.bounds.insert(a);
+        }
+
+        if (a[axis] >= pos)
+        {
+            right.bounds.insert(a);
+        }
+
+        if ((a[axis] < pos && b[axis] > pos) || (a[axis] > pos && b[axis] < pos))
+        {
+            vec3 t = a + (b - a) * ((pos - a[axis]) / (b[axis] - a[axis]));
+            t[axis] = pos;
+            left.bounds.insert(t);
+            right.bounds.insert(t);
+        }
+    }
+
+    left.bounds  = aabb(max(left.bounds.min, ref.bounds.min), min(left.bounds.max, ref.bounds.max));
+    right.bounds = aabb(max(right.bounds.min, ref.bounds.min), min(right.bounds.max, ref.bounds.max));
+
+    left.bounds.max[axis]  = std::min(left.bounds.max[axis], pos);
+    right.bounds.min[axis] = std::max(right.bounds.min[axis], pos);
+}
+
+} // namespace visionaray